@@ -16,18 +16,28 @@
  */
 
 #include <ctype.h>
+#include <dirent.h>
 #include <limits.h>
+#include <poll.h>
 #include <stdarg.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "arena.h"
+#include "intern.h"
 #include "valtypes.h"
 #include "symboltable.h"
 #include "codegen.h"
 #include "boolean.h"
 #include "errmsg.h"
 #include "error.h"
+#include "profile.h"
 #include "scanner.h"
 #include "token.h"
+#include "tokenring.h"
 
 /* --- type definitions ----------------------------------------------------- */
 
@@ -63,6 +73,20 @@ Token token; /**< the lookahead token type                           */
 ValType return_type;  /**< the return type of the current subroutine          */
 #endif
 
+static Boolean check_only;	/**< validate only, and generate no code         */
+static Boolean emit_jasmin; /**< write Jasmin text and assemble it externally */
+static Boolean optimise;	/**< generate optimised code                      */
+static Boolean profiling;	/**< report per-phase times and counters          */
+static char *jasmin_path;	/**< the Jasmin JAR (debug path only)             */
+static char *cache_dir;		/**< the artifact cache directory, or NULL        */
+static char **jasm_files;	/**< Jasmin files awaiting batch assembly         */
+static int num_jasm_files;	/**< the number of entries in jasm_files          */
+static int jasm_pipe;		/**< worker-to-driver file name channel, or -1    */
+static int jasm_pipe_rd;	/**< the driver's end of the channel, or -1       */
+static char	 *jasm_buf;		/**< raw bytes drained from the worker pipe       */
+static size_t jasm_len;		/**< the number of bytes in jasm_buf              */
+static size_t jasm_cap;		/**< the allocated size of jasm_buf               */
+
 
 /* --- helper macros -------------------------------------------------------- */
 
@@ -127,71 +151,535 @@ Variable *variable(char *id, ValType type, SourcePos pos);
 void abort_c(Error err, ...);
 void abort_cp(SourcePos *posp, Error err, ...);
 
+/* --- function prototypes: compilation driver ------------------------------ */
+
+void compile_file(char *src_name);
+unsigned long long hash_file(FILE *file);
+Boolean cache_lookup(unsigned long long src_hash);
+void cache_store(unsigned long long src_hash);
+void copy_file(const char *from, const char *to);
+void record_jasmin_file(const char *name);
+void drain_jasm_pipe(Boolean block);
+void finish_assembly(void);
+
 /* --- main routine --------------------------------------------------------- */
 
 int main(int argc, char *argv[])
 {
-
-	char *jasmin_path;
-
-	FILE *src_file;
-
+	int	  i, first, jobs, active, status, failed;
+	int	  fds[2];
+	pid_t pid;
 
 	/* set up global variables */
 	setprogname(argv[0]);
 
 	/* check command-line arguments and environment */
-	if (argc != 2)
+	emit_jasmin	 = FALSE;
+	jasm_pipe	 = -1;
+	jasm_pipe_rd = -1;
+	jobs		 = 1;
+	first		 = 1;
+
+	while (first < argc && argv[first][0] == '-')
+	{
+		if (strcmp(argv[first], "--check-only") == 0)
+		{
+			check_only = TRUE;
+			set_check_only(TRUE);
+			first++;
+		} else if (strcmp(argv[first], "--emit-jasmin") == 0) {
+			emit_jasmin = TRUE;
+			first++;
+		} else if (strcmp(argv[first], "-O") == 0) {
+			optimise = TRUE;
+			set_optimise(TRUE);
+			first++;
+		} else if (strcmp(argv[first], "--profile") == 0) {
+			profiling = TRUE;
+			first++;
+		} else if (strcmp(argv[first], "--cache") == 0 && first + 1 < argc) {
+			cache_dir = argv[first + 1];
+			first += 2;
+		} else if (strcmp(argv[first], "-j") == 0 && first + 1 < argc) {
+			jobs = atoi(argv[first + 1]);
+			if (jobs < 1)
+			{
+				eprintf("invalid number of jobs '%s'", argv[first + 1]);
+			}
+			first += 2;
+		} else {
+			eprintf("usage: %s [--check-only] [--emit-jasmin] [-O]"
+				" [--cache dir] [-j jobs] <filename> ...", getprogname());
+		}
+	}
+
+	if (first == argc)
 	{
-		eprintf("usage: %s <filename>", getprogname());
+		eprintf("usage: %s [--check-only] [--emit-jasmin] [-O]"
+			" [--cache dir] [-j jobs] <filename> ...", getprogname());
 	}
 
-	if ((jasmin_path = getenv("JASMIN_JAR")) == NULL)
+	/* Jasmin is only needed for the debug path */
+	jasmin_path = NULL;
+	if (emit_jasmin && (jasmin_path = getenv("JASMIN_JAR")) == NULL)
 	{
 		eprintf("JASMIN_JAR environment variable not set");
 	}
 
-	setsrcname(argv[1]);
+	failed = 0;
+
+	if (jobs == 1 || argc - first == 1)
+	{
+		for (i = first; i < argc; i++)
+		{
+			compile_file(argv[i]);
+		}
+	} else {
+
+		/* A pool of forked workers, with at most `jobs` compilations in
+		 * flight at a time.  Workers are forked rather than threaded: every
+		 * compiler unit keeps its state in unit globals, and copy-on-write
+		 * gives each worker a private copy of all of it -- including the
+		 * already-built keyword tables -- without a single lock.  A failed
+		 * compilation takes down only its own worker.
+		 */
+		if (emit_jasmin)
+		{
+			/* workers report their Jasmin files back over a pipe */
+			if (pipe(fds) < 0)
+			{
+				eprintf("Could not create a pipe to the compiler workers");
+			}
+			jasm_pipe_rd = fds[0];
+			jasm_pipe	 = fds[1];
+		}
+
+		active = 0;
+		for (i = first; i < argc; i++)
+		{
+			if (active == jobs)
+			{
+				if (jasm_pipe_rd >= 0)
+				{
+					drain_jasm_pipe(FALSE);
+				}
+				if (wait(&status) > 0
+					&& !(WIFEXITED(status)
+						 && WEXITSTATUS(status) == EXIT_SUCCESS))
+				{
+					failed = 1;
+				}
+				active--;
+			}
+
+			if ((pid = fork()) < 0)
+			{
+				eprintf("Could not fork a compiler worker");
+			} else if (pid == 0) {
+				compile_file(argv[i]);
+				_exit(EXIT_SUCCESS);
+			}
+			active++;
+		}
+
+		/* the pipe only buffers 64 KiB or so: it must be read to end-of-file
+		 * BEFORE reaping, or workers still reporting names would block on a
+		 * full pipe -- and never exit -- while the driver blocks in wait()
+		 */
+		if (jasm_pipe_rd >= 0)
+		{
+			close(jasm_pipe);
+			jasm_pipe = -1;
+			drain_jasm_pipe(TRUE);
+		}
+
+		while (active-- > 0)
+		{
+			if (wait(&status) > 0
+				&& !(WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS))
+			{
+				failed = 1;
+			}
+		}
+	}
+
+	if (emit_jasmin)
+	{
+		finish_assembly();
+	}
+
+	freeprogname();
+
+	return (failed ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+/**
+ * Runs one source file through the complete pipeline: every compiler unit is
+ * initialised, the program is parsed, the classfile (or, on the debug path,
+ * the Jasmin file) is written, and all per-compilation resources are released
+ * again, so that the next file starts from a clean slate.
+ *
+ * @param[in] src_name the name of the source file to compile
+ */
+void compile_file(char *src_name)
+{
+	FILE			  *src_file;
+	struct stat		   st;
+	unsigned long long src_hash;
+	Boolean			   cacheable;
+
+	setsrcname(src_name);
 
 	/* open the source file, and report an error if it cannot be opened */
-	if ((src_file = fopen(argv[1], "r")) == NULL)
+	if ((src_file = fopen(src_name, "r")) == NULL)
+	{
+		eprintf("file '%s' could not be opened:", src_name);
+	}
+
+	/* a check produces no artifact, so the cache does not apply; neither
+	 * does it apply to a pipe or other non-seekable input, since hashing
+	 * reads the stream to EOF and only a regular file can be rewound
+	 */
+	cacheable = cache_dir != NULL && !check_only
+		&& fstat(fileno(src_file), &st) == 0 && S_ISREG(st.st_mode);
+
+	src_hash = 0;
+	if (cacheable)
 	{
-		eprintf("file '%s' could not be opened:", argv[1]);
+		src_hash = hash_file(src_file);
+		/* flags that change the artifact are part of its identity, or an
+		 * optimised entry would satisfy an unoptimised compile */
+		src_hash ^= (unsigned char)(optimise ? 'O' : '-');
+		src_hash *= 1099511628211ULL;
+		rewind(src_file);
+		if (cache_lookup(src_hash))
+		{
+			fclose(src_file);
+			freesrcname();
+			return;
+		}
 	}
 
 	/* initialise all compiler units */
+	init_profile();
 	init_scanner(src_file);
+	init_token_ring();
 
+	init_arena();
+	init_intern_pool();
 	init_symbol_table();
 	init_code_generation();
 
-	get_token(&token);
+	profile_start(PROF_PARSE);
+	next_token(&token);
 	parse_program();
+	profile_end(PROF_PARSE);
+
+	profile_start(PROF_EMIT);
+	if (check_only)
+	{
+		/* validation only: there is nothing to emit */
+	} else if (emit_jasmin) {
+		make_code_file();
+		record_jasmin_file(get_jasmin_file_name());
+	} else
+	{
+		make_class_file();
+	}
+	profile_end(PROF_EMIT);
 
-	make_code_file();
-	assemble(jasmin_path);
+	/* the debug path has no classfile to cache until the batch is assembled */
+	if (cacheable && !emit_jasmin)
+	{
+		cache_store(src_hash);
+	}
 
 #ifdef DEBUG_CODEGEN
 	list_code();
 #endif
 
-	/* produce the object code, and assemble */
-	
-
 	/* release all allocated resources */
-	
+
 	release_code_generation();
 	release_symbol_table();
+	release_intern_pool();
+	release_arena();
+	release_token_ring();
+	release_scanner();
 
 	fclose(src_file);
-	freeprogname();
 	freesrcname();
 
+	if (profiling)
+	{
+		profile_report(src_name);
+	}
+
 #ifdef DEBUG_PARSER
 	printf("Success!\n");
 #endif
+}
+
+/**
+ * Computes the FNV-1a hash of the contents of the specified file.  The hash
+ * identifies the source text, so any edit -- including whitespace -- misses
+ * the cache and recompiles.
+ *
+ * @param[in] file the open source file; the position is left at end-of-file
+ * @return the 64-bit content hash
+ */
+unsigned long long hash_file(FILE *file)
+{
+	unsigned long long hash;
+	unsigned char	   buffer[4096];
+	size_t			   nread, i;
+
+	hash = 14695981039346656037ULL;
+	while ((nread = fread(buffer, 1, sizeof(buffer), file)) > 0)
+	{
+		for (i = 0; i < nread; i++)
+		{
+			hash ^= buffer[i];
+			hash *= 1099511628211ULL;
+		}
+	}
+
+	return hash;
+}
+
+/**
+ * Looks for a cached artifact of the specified source hash, and copies it to
+ * the working directory on a hit.  Cache entries are named
+ * <code>&lt;hash&gt;-&lt;classfile name&gt;</code>, so the hit restores the
+ * artifact under the name the compilation would have produced.
+ *
+ * @param[in] src_hash the content hash of the source file
+ * @return TRUE on a cache hit, FALSE otherwise
+ */
+Boolean cache_lookup(unsigned long long src_hash)
+{
+	DIR			  *dir;
+	struct dirent *entry;
+	char		   prefix[32], from[PATH_MAX];
+
+	if ((dir = opendir(cache_dir)) == NULL)
+	{
+		return FALSE;
+	}
+
+	snprintf(prefix, sizeof(prefix), "%016llx-", src_hash);
+
+	while ((entry = readdir(dir)) != NULL)
+	{
+		if (strncmp(entry->d_name, prefix, strlen(prefix)) == 0)
+		{
+			snprintf(from, sizeof(from), "%s/%s", cache_dir, entry->d_name);
+			copy_file(from, entry->d_name + strlen(prefix));
+			closedir(dir);
+			return TRUE;
+		}
+	}
+
+	closedir(dir);
+
+	return FALSE;
+}
+
+/**
+ * Stores the classfile produced by the compilation that just finished under
+ * the specified source hash.  The artifact is written to a process-private
+ * temporary name first and then renamed, so concurrent workers caching the
+ * same entry cannot observe a half-written file.
+ *
+ * @param[in] src_hash the content hash of the source file
+ */
+void cache_store(unsigned long long src_hash)
+{
+	char to[PATH_MAX], tmp[PATH_MAX + 16];
+
+	mkdir(cache_dir, 0777); /* already existing is fine */
+
+	snprintf(to, sizeof(to), "%s/%016llx-%s", cache_dir, src_hash,
+		get_class_file_name());
+	snprintf(tmp, sizeof(tmp), "%s.%ld", to, (long)getpid());
+
+	copy_file(get_class_file_name(), tmp);
+	if (rename(tmp, to) != 0)
+	{
+		eprintf("could not store cache entry '%s':", to);
+	}
+}
+
+/**
+ * Copies a file byte for byte.
+ *
+ * @param[in] from the path to copy from
+ * @param[in] to   the path to copy to
+ */
+void copy_file(const char *from, const char *to)
+{
+	FILE  *src, *dst;
+	char   buffer[4096];
+	size_t nread;
+
+	if ((src = fopen(from, "rb")) == NULL)
+	{
+		eprintf("file '%s' could not be opened:", from);
+	}
+	if ((dst = fopen(to, "wb")) == NULL)
+	{
+		eprintf("file '%s' could not be opened:", to);
+	}
+
+	while ((nread = fread(buffer, 1, sizeof(buffer), src)) > 0)
+	{
+		if (fwrite(buffer, 1, nread, dst) != nread)
+		{
+			eprintf("could not write '%s':", to);
+		}
+	}
+
+	fclose(src);
+	fclose(dst);
+}
+
+/**
+ * Records a Jasmin file for assembly at the end of the run.  Inside a forked
+ * worker, the name is sent to the driver over the pipe; otherwise, it is
+ * appended to the in-process list.
+ *
+ * @param[in] name the name of the Jasmin file
+ */
+void record_jasmin_file(const char *name)
+{
+	char   line[PATH_MAX + 1];
+	size_t len;
+
+	if (jasm_pipe >= 0)
+	{
+		/* several workers share the pipe, so the name and its terminator
+		 * must go out in one write of at most PIPE_BUF bytes, which POSIX
+		 * guarantees is atomic; two writes could interleave */
+		len = (size_t)snprintf(line, sizeof(line), "%s\n", name);
+		if (len >= sizeof(line) || write(jasm_pipe, line, len) < 0)
+		{
+			eprintf("could not record '%s' for assembly:", name);
+		}
+		return;
+	}
+
+	jasm_files = erealloc(jasm_files, (num_jasm_files + 1) * sizeof(char *));
+	jasm_files[num_jasm_files++] = estrdup(name);
+}
+
+/**
+ * Drains worker reports from the Jasmin file name pipe into the raw buffer.
+ * A pipe only buffers 64 KiB or so, so the driver must keep reading while
+ * workers run: a worker blocked on a full pipe never exits, and the driver
+ * would then deadlock in <code>wait()</code>.  A non-blocking call takes only
+ * the bytes already in the pipe; a blocking call reads until every write end
+ * has closed.
+ *
+ * @param[in] block whether to read through to end-of-file
+ */
+void drain_jasm_pipe(Boolean block)
+{
+	struct pollfd pfd;
+	ssize_t		  n;
+
+	if (jasm_buf == NULL)
+	{
+		jasm_len = 0;
+		jasm_cap = 4096;
+		jasm_buf = emalloc(jasm_cap);
+	}
+
+	for (;;)
+	{
+		if (!block)
+		{
+			pfd.fd	   = jasm_pipe_rd;
+			pfd.events = POLLIN;
+			if (poll(&pfd, 1, 0) <= 0)
+			{
+				return;
+			}
+		}
+
+		if ((n = read(jasm_pipe_rd, jasm_buf + jasm_len, jasm_cap - jasm_len))
+			<= 0)
+		{
+			return;
+		}
+
+		jasm_len += n;
+		if (jasm_len == jasm_cap)
+		{
+			jasm_cap *= 2;
+			jasm_buf  = erealloc(jasm_buf, jasm_cap);
+		}
+	}
+}
+
+/**
+ * Assembles every Jasmin file produced during this run with one Jasmin
+ * invocation, so that a batch pays for a single JVM start-up rather than one
+ * per file, and removes the Jasmin files afterwards.  In a parallel run, the
+ * file names are first collected from the worker pipe.
+ */
+void finish_assembly(void)
+{
+	char *line;
+	int	  i;
+
+	if (jasm_pipe_rd >= 0)
+	{
+		/* pick up any final reports, and turn the raw bytes into names */
+		if (jasm_pipe >= 0)
+		{
+			close(jasm_pipe);
+			jasm_pipe = -1;
+		}
+		drain_jasm_pipe(TRUE);
+		close(jasm_pipe_rd);
+		jasm_pipe_rd = -1;
+
+		line = jasm_buf;
+		for (i = 0; (size_t)i < jasm_len; i++)
+		{
+			if (jasm_buf[i] == '\n')
+			{
+				jasm_buf[i] = '\0';
+				record_jasmin_file(line);
+				line = jasm_buf + i + 1;
+			}
+		}
+		free(jasm_buf);
+		jasm_buf = NULL;
+		jasm_len = jasm_cap = 0;
+	}
+
+	if (num_jasm_files == 0)
+	{
+		return;
+	}
+
+	assemble(jasmin_path, num_jasm_files, jasm_files);
+
+#ifndef DEBUG_CODEGEN
+	for (i = 0; i < num_jasm_files; i++)
+	{
+		unlink(jasm_files[i]);
+	}
+#endif
 
-	return EXIT_SUCCESS;
+	for (i = 0; i < num_jasm_files; i++)
+	{
+		free(jasm_files[i]);
+	}
+	free(jasm_files);
+	jasm_files	   = NULL;
+	num_jasm_files = 0;
 }
 
 /* --- parser routines ------------------------------------------------------ */
@@ -225,7 +713,6 @@ void parse_program(void)
 	gen_1(JVM_RETURN);
 	close_subroutine_codegen(get_variables_width());
 
-	free(class_name);
 	DBG_end("</program>");
 }
 
@@ -244,13 +731,13 @@ void parse_subdef(void)
 	char	 *id, *name;
 	int		  counter, i;
 	ValType	 *type;
-	Variable *head, *var;
+	Variable *head, *var, *curr;
 
-	var = (Variable *)malloc(sizeof(Variable));
+	var = (Variable *)arena_alloc(sizeof(Variable));
 
-	type = (ValType *)malloc(sizeof(ValType));
+	type = (ValType *)arena_alloc(sizeof(ValType));
 
-	prop = (IDPropt *)malloc(sizeof(IDPropt));
+	prop = (IDPropt *)arena_alloc(sizeof(IDPropt));
 
 	DBG_start("<subdef>");
 
@@ -270,9 +757,9 @@ void parse_subdef(void)
 
 	while (token.type == TOK_COMMA)
 	{
-		get_token(&token);
+		next_token(&token);
 		counter++;
-		Variable *newVariable = (Variable *)malloc(sizeof(Variable));
+		Variable *newVariable = (Variable *)arena_alloc(sizeof(Variable));
 		parse_type(type);
 		newVariable->pos = position;
 		expect_id(&id);
@@ -298,33 +785,33 @@ void parse_subdef(void)
 	var->next = head;
 
 	prop->nparams = counter;
-	prop->params  = (ValType *)emalloc(sizeof(ValType) * counter + 1);
+	prop->params  = (ValType *)arena_alloc(sizeof(ValType) * counter + 1);
 
+	curr = var;
 	for (i = 0; i < counter; i++)
 	{
-		prop->params[i] = var->type;
-		var				= var->next;
+		prop->params[i] = curr->type;
+		curr			= curr->next;
 	}
-
-	/*IDPropt* idprop = idpropt(returnType, localVarOffset, numParams,
-	 * paramTypes);*/
+	prop->type = TYPE_CALLABLE;
 
 	open_subroutine(name, prop);
-	IDPropt *temp = NULL;
 
+	curr = var;
 	for (i = 0; i < counter; i++)
 	{
-		temp->type = prop->params[i];
-		insert_name(var->id, temp);
-		var = var->next;
+		insert_name(curr->id, idpropt(curr->type, 0, 0, NULL));
+		curr = curr->next;
 	}
 
 	expect(TOK_RPAREN);
 
 	if (token.type == TOK_ARROW)
 	{
-		get_token(&token);
+		next_token(&token);
 		parse_type(type);
+		prop->type = *type;
+		SET_AS_CALLABLE(prop->type);
 	}
 
 	expect(TOK_COLON);
@@ -377,12 +864,12 @@ void parse_type(ValType *type)
 	{
 		*type = TYPE_BOOLEAN;
 	}
-	get_token(&token);
+	next_token(&token);
 
 	if (token.type == TOK_ARRAY)
 	{
 		SET_AS_ARRAY(*type);
-		get_token(&token);
+		next_token(&token);
 	}
 
 	DBG_end("</type>");
@@ -407,7 +894,7 @@ void parse_vardef(void)
 
 	while (token.type == TOK_COMMA)
 	{
-		get_token(&token);
+		next_token(&token);
 		expect_id(&id);
 		insert_name(id, idpropt(type, 0, 0, NULL));
 	}
@@ -426,12 +913,12 @@ void parse_statements(void)
 	DBG_start("<statements>");
 	if (token.type == TOK_CHILLAX)
 	{
-		get_token(&token);
+		next_token(&token);
 	} else {
 		parse_statement();
 		while (token.type == TOK_SEMICOLON)
 		{
-			get_token(&token);
+			next_token(&token);
 			parse_statement();
 		}
 	}
@@ -530,7 +1017,7 @@ void parse_assign(void)
 			gen_2(JVM_ISTORE, propt->offset);
 		}
 	} else if (token.type == TOK_ARRAY) {
-		get_token(&token);
+		next_token(&token);
 		parse_simple(&type);
 
 		if (IS_INTEGER_TYPE(type))
@@ -586,7 +1073,7 @@ void parse_if(void)
 	while (token.type == TOK_ELIF)
 	{
 		DBG_info("<elif>");
-		get_token(&token);
+		next_token(&token);
 		end = get_label();
 
 		parse_expr(&type);
@@ -604,7 +1091,7 @@ void parse_if(void)
 	if (token.type == TOK_ELSE)
 	{
 		DBG_info("<else>");
-		get_token(&token);
+		next_token(&token);
 		expect(TOK_COLON);
 		parse_statements();
 		DBG_info("</else>");
@@ -679,8 +1166,8 @@ void parse_output()
 
 	if (token.type == TOK_STR)
 	{
-		get_token(&token);
 		gen_print_string(token.string);
+		next_token(&token);
 	} else if (STARTS_EXPR(token.type)) {
 		parse_expr(&type);
 
@@ -692,11 +1179,11 @@ void parse_output()
 
 	while (token.type == TOK_DOTDOT)
 	{
-		get_token(&token);
+		next_token(&token);
 		if (token.type == TOK_STR)
 		{
-			get_token(&token);
 			gen_print_string(token.string);
+			next_token(&token);
 		} else if (STARTS_EXPR(token.type)) {
 			parse_expr(&type);
 			gen_print(type);
@@ -770,7 +1257,7 @@ void parse_arglist()
 
 	while (token.type == TOK_COMMA)
 	{
-		get_token(&token);
+		next_token(&token);
 		parse_expr(&type);
 	}
 
@@ -816,32 +1303,32 @@ void parse_expr(ValType *type)
 		switch (token.type)
 		{
 			case TOK_EQ:
-				get_token(&token);
+				next_token(&token);
 				parse_simple(&temp);
 				gen_cmp(JVM_IF_ICMPEQ);
 				break;
 			case TOK_GE:
-				get_token(&token);
+				next_token(&token);
 				parse_simple(&temp);
 				gen_cmp(JVM_IF_ICMPGE);
 				break;
 			case TOK_GT:
-				get_token(&token);
+				next_token(&token);
 				parse_simple(&temp);
 				gen_cmp(JVM_IF_ICMPGT);
 				break;
 			case TOK_LE:
-				get_token(&token);
+				next_token(&token);
 				parse_simple(&temp);
 				gen_cmp(JVM_IF_ICMPLE);
 				break;
 			case TOK_LT:
-				get_token(&token);
+				next_token(&token);
 				parse_simple(&temp);
 				gen_cmp(JVM_IF_ICMPLT);
 				break;
 			case TOK_NE:
-				get_token(&token);
+				next_token(&token);
 				parse_simple(&temp);
 				gen_cmp(JVM_IF_ICMPNE);
 				break;
@@ -870,7 +1357,7 @@ void parse_simple(ValType *type)
 	if (token.type == TOK_MINUS)
 	{
 
-		get_token(&token);
+		next_token(&token);
 		parse_term(type);
 		gen_1(JVM_INEG);
 
@@ -882,17 +1369,17 @@ void parse_simple(ValType *type)
 		switch (token.type)
 		{
 			case TOK_MINUS:
-				get_token(&token);
+				next_token(&token);
 				parse_term(type);
 				gen_1(JVM_ISUB);
 				break;
 			case TOK_PLUS:
-				get_token(&token);
+				next_token(&token);
 				parse_term(type);
 				gen_1(JVM_IADD);
 				break;
 			case TOK_OR:
-				get_token(&token);
+				next_token(&token);
 				parse_term(type);
 				gen_1(JVM_IOR);
 				break;
@@ -919,22 +1406,22 @@ void parse_term(ValType *type)
 		switch (token.type)
 		{
 			case TOK_MUL:
-				get_token(&token);
+				next_token(&token);
 				parse_factor(type);
 				gen_1(JVM_IMUL);
 				break;
 			case TOK_DIV:
-				get_token(&token);
+				next_token(&token);
 				parse_factor(type);
 				gen_1(JVM_IDIV);
 				break;
 			case TOK_AND:
-				get_token(&token);
+				next_token(&token);
 				parse_factor(type);
 				gen_1(JVM_IAND);
 				break;
 			case TOK_REM:
-				get_token(&token);
+				next_token(&token);
 				parse_factor(type);
 				gen_1(JVM_IREM);
 				break;
@@ -984,19 +1471,19 @@ void parse_factor(ValType *vt)
 
 			*vt = TYPE_INTEGER;
 			gen_2(JVM_LDC, token.value);
-			get_token(&token);
+			next_token(&token);
 
 			break;
 
 		case TOK_LPAREN:
-			get_token(&token);
+			next_token(&token);
 			parse_expr(vt);
 			expect(TOK_RPAREN);
 			break;
 
 		case TOK_NOT:
 
-			get_token(&token);
+			next_token(&token);
 
 			parse_factor(vt);
 			gen_2(JVM_LDC, 1);
@@ -1008,7 +1495,7 @@ void parse_factor(ValType *vt)
 
 			gen_2(JVM_LDC, 1);
 			*vt = TYPE_BOOLEAN;
-			get_token(&token);
+			next_token(&token);
 			break;
 
 		case TOK_FALSE:
@@ -1016,7 +1503,7 @@ void parse_factor(ValType *vt)
 			gen_2(JVM_LDC, 0);
 
 			*vt = TYPE_BOOLEAN;
-			get_token(&token);
+			next_token(&token);
 			break;
 
 		default:
@@ -1059,7 +1546,7 @@ void expect(TokenType type)
 {
 	if (token.type == type)
 	{
-		get_token(&token);
+		next_token(&token);
 	} else {
 		abort_c(ERR_EXPECT, type);
 	}
@@ -1069,8 +1556,8 @@ void expect_id(char **id)
 {
 	if (token.type == TOK_ID)
 	{
-		*id = estrdup(token.lexeme);
-		get_token(&token);
+		*id = (char *)intern(token.lexeme);
+		next_token(&token);
 	} else {
 
 		abort_c(ERR_EXPECT, TOK_ID);
@@ -1085,7 +1572,7 @@ void expect_id(char **id)
 IDPropt *idpropt(ValType type, unsigned int offset, unsigned int nparams,
 ValType*params)
 {
-	IDPropt *ip = emalloc(sizeof(*ip));
+	IDPropt *ip = arena_alloc(sizeof(*ip));
 
 	ip->type	= type;
 	ip->offset	= offset;
@@ -1097,7 +1584,7 @@ ValType*params)
 
 Variable *variable(char *id, ValType type, SourcePos pos)
 {
-	Variable *vp = emalloc(sizeof(*vp));
+	Variable *vp = arena_alloc(sizeof(*vp));
 
 	vp->id	 = id;
 	vp->type = type;
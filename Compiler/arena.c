@@ -0,0 +1,120 @@
+/**
+ * @file    arena.c
+ * @brief   A compiler-lifetime arena allocator for AMPL-2023.
+ * @date    2023-08-10
+ */
+
+#include "arena.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "error.h"
+
+/* the default block size; oversized requests get a block of their own */
+#define ARENA_BLOCK_SIZE (64 * 1024)
+
+/* round allocation sizes up to keep every returned pointer aligned */
+#define ARENA_ALIGNMENT (sizeof(void *) * 2)
+#define ARENA_ALIGN(n) (((n) + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1))
+
+/** a block of arena memory */
+typedef struct arena_block ArenaBlock;
+struct arena_block {
+	ArenaBlock *next; /**< the previously filled block  */
+	size_t		used; /**< the number of bytes in use   */
+	size_t		size; /**< the capacity of this block   */
+	/* the payload bytes follow the header */
+};
+
+/* --- global static variables ---------------------------------------------- */
+
+static ArenaBlock *blocks; /* the current block, head of the block list */
+
+/* --- function prototypes -------------------------------------------------- */
+
+static ArenaBlock *new_block(size_t payload_size);
+
+/* --- arena interface ------------------------------------------------------- */
+
+void init_arena(void)
+{
+	blocks = new_block(ARENA_BLOCK_SIZE);
+}
+
+void *arena_alloc(size_t n)
+{
+	ArenaBlock *block;
+	char	   *p;
+
+	n = ARENA_ALIGN(n);
+
+	if (n > ARENA_BLOCK_SIZE)
+	{
+		/* an oversized request gets a dedicated block, linked in behind the
+		 * current block so that its remaining space stays available
+		 */
+		block		 = new_block(n);
+		block->used	 = n;
+		block->next	 = blocks->next;
+		blocks->next = block;
+		return (char *)block + sizeof(ArenaBlock);
+	}
+
+	if (blocks->used + n > blocks->size)
+	{
+		block		= new_block(ARENA_BLOCK_SIZE);
+		block->next = blocks;
+		blocks		= block;
+	}
+
+	p = (char *)blocks + sizeof(ArenaBlock) + blocks->used;
+	blocks->used += n;
+
+	return p;
+}
+
+char *arena_strdup(const char *s)
+{
+	size_t len;
+	char  *t;
+
+	len = strlen(s) + 1;
+	t	= arena_alloc(len);
+	memcpy(t, s, len);
+
+	return t;
+}
+
+void release_arena(void)
+{
+	ArenaBlock *block, *next;
+
+	for (block = blocks; block != NULL; block = next)
+	{
+		next = block->next;
+		free(block);
+	}
+
+	blocks = NULL;
+}
+
+/* --- utility functions ---------------------------------------------------- */
+
+/**
+ * Allocates a fresh, unlinked arena block.
+ *
+ * @param[in] payload_size the number of payload bytes the block must hold
+ * @return a pointer to the new block
+ */
+static ArenaBlock *new_block(size_t payload_size)
+{
+	ArenaBlock *block;
+
+	block		= emalloc(sizeof(ArenaBlock) + payload_size);
+	block->next = NULL;
+	block->used = 0;
+	block->size = payload_size;
+
+	return block;
+}
@@ -0,0 +1,54 @@
+/**
+ * @file    arena.h
+ * @brief   Definitions for the compiler-lifetime arena allocator of AMPL-2023.
+ * @date    2023-08-10
+ *
+ * The arena serves the many small, never-individually-freed allocations made
+ * during a compilation -- parser nodes, identifier properties, identifier
+ * strings, and hash table entries.  Allocation is a pointer bump into large
+ * blocks, and the whole arena is released in one call at the end of
+ * compilation, so no per-node free calls are required anywhere.
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/**
+ * Initialise the arena.  This must be called before any of the other arena
+ * functions, and may be called again after <code>release_arena</code> to
+ * start a fresh compilation.
+ */
+void init_arena(void);
+
+/**
+ * Allocate memory from the arena, and terminate the program with a message on
+ * the standard error stream if the allocation fails.  The returned memory is
+ * suitably aligned for any object type, and remains valid until
+ * <code>release_arena</code> is called.
+ *
+ * @param[in]  n
+ *     the number of bytes to allocate
+ * @return
+ *     a pointer to the newly allocated memory
+ */
+void *arena_alloc(size_t n);
+
+/**
+ * Duplicate a string into the arena, and terminate the program with a message
+ * on the standard error stream if the allocation fails.
+ *
+ * @param[in]  s
+ *     the string to duplicate
+ * @return
+ *     a pointer to arena memory that contains a copy of the string
+ */
+char *arena_strdup(const char *s);
+
+/**
+ * Release all memory held by the arena in one call.
+ */
+void release_arena(void);
+
+#endif /* ARENA_H */
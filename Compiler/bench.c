@@ -0,0 +1,446 @@
+/**
+ * @file    bench.c
+ * @brief   Throughput benchmarks for the AMPL-2023 compiler phases.
+ *
+ * The driver synthesizes AMPL source of parameterized shape and times each
+ * hot phase in isolation: tokens per second through <code>get_token</code>,
+ * insertions and lookups per second through the hash table at several load
+ * factors, and instructions per second through <code>gen_2</code>.  Results
+ * are reported against <code>bench.baseline</code> when that file exists;
+ * running with <code>--update</code> rewrites the baseline from the current
+ * run, so regressions show up as deltas on the next run.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "arena.h"
+#include "boolean.h"
+#include "codegen.h"
+#include "error.h"
+#include "hashtable.h"
+#include "jvm.h"
+#include "scanner.h"
+#include "symboltable.h"
+#include "token.h"
+#include "valtypes.h"
+
+/* --- benchmark parameters ------------------------------------------------- */
+
+#define SCAN_ROUNDS	   (20)		 /* tokenisation passes over each corpus     */
+#define HT_KEYS		   (200000)	 /* keys inserted per hash table run         */
+#define HT_ROUNDS	   (5)		 /* search passes over the full key set      */
+#define GEN_PAIRS	   (1000000) /* iload/istore pairs emitted through gen_2 */
+#define BASELINE_FILE  "bench.baseline"
+#define MAX_RESULTS	   (16)
+
+/* --- global static variables ---------------------------------------------- */
+
+static struct {
+	const char *name;  /* the metric name     */
+	double		value; /* operations per second */
+} results[MAX_RESULTS];
+static int nresults;
+
+/* --- function prototypes -------------------------------------------------- */
+
+static void	  bench_codegen(void);
+static void	  bench_hashtable(HTKind kind, float loadfactor,
+	  const char *name);
+static void	  bench_scanner(const char *name, int nsubs, int nstmts,
+	  int depth, int idlen, int density);
+static void	  emit_body(FILE *f, int indent, int nstmts, int depth,
+	  int idlen, int density);
+static void	  generate_corpus(FILE *f, int nsubs, int nstmts, int depth,
+	  int idlen, int density);
+static double now_s(void);
+static void	  noop_free(void *p);
+static int	  ptr_cmp(void *val1, void *val2);
+static unsigned int ptr_hash(void *key, unsigned int size);
+static void	  record(const char *name, double value);
+static void	  report(Boolean update);
+
+/* --- main routine --------------------------------------------------------- */
+
+int main(int argc, char *argv[])
+{
+	Boolean update;
+
+	setprogname(argv[0]);
+
+	update = (argc > 1 && strcmp(argv[1], "--update") == 0);
+	if (argc > 1 && !update)
+	{
+		eprintf("usage: %s [--update]", getprogname());
+	}
+
+	/* identifier-dense, literal-dense, and deeply nested corpora */
+	bench_scanner("scan.dense", 20, 60, 2, 24, 90);
+	bench_scanner("scan.literal", 20, 60, 2, 8, 10);
+	bench_scanner("scan.nested", 5, 20, 12, 12, 50);
+
+	bench_hashtable(HT_CHAINED, 0.75f, "ht.chained.lf075");
+	bench_hashtable(HT_CHAINED, 1.50f, "ht.chained.lf150");
+	bench_hashtable(HT_OPEN_ADDRESSING, 0.50f, "ht.open.lf050");
+	bench_hashtable(HT_OPEN_ADDRESSING, 0.90f, "ht.open.lf090");
+
+	bench_codegen();
+
+	report(update);
+
+	freeprogname();
+
+	return EXIT_SUCCESS;
+}
+
+/* --- benchmark phases ----------------------------------------------------- */
+
+/**
+ * Times raw instruction emission through <code>gen_2</code>.  The emitted
+ * stream alternates iload and istore of the same slot, so the stack stays
+ * balanced when the subroutine is closed and its limits are computed.
+ */
+static void bench_codegen(void)
+{
+	IDPropt prop;
+	double	start, elapsed;
+	long	i;
+
+	memset(&prop, 0, sizeof(prop));
+	prop.type = TYPE_CALLABLE;
+
+	init_code_generation();
+	init_subroutine_codegen("main", &prop);
+
+	start = now_s();
+	for (i = 0; i < GEN_PAIRS; i++)
+	{
+		gen_2(JVM_ILOAD, (int)(i & 3));
+		gen_2(JVM_ISTORE, (int)(i & 3));
+	}
+	elapsed = now_s() - start;
+
+	close_subroutine_codegen(4);
+	release_code_generation();
+
+	record("gen.instrs_per_sec", 2.0 * GEN_PAIRS / elapsed);
+}
+
+/**
+ * Times insertions and lookups through the hash table.  Keys are compared by
+ * identity and hashed on their addresses, which is how the symbol table uses
+ * the table ever since identifiers became interned.
+ *
+ * @param[in] kind       the table implementation to exercise
+ * @param[in] loadfactor the maximum load factor before a resize
+ * @param[in] name       the metric name to report under
+ */
+static void bench_hashtable(HTKind kind, float loadfactor, const char *name)
+{
+	HashTab *ht;
+	char   **keys;
+	char	 metric[64];
+	double	 start, elapsed;
+	int		 i, r;
+
+	init_arena();
+	if ((ht = ht_init_kind(kind, loadfactor, ptr_hash, ptr_cmp)) == NULL)
+	{
+		eprintf("could not initialise the hash table");
+	}
+
+	keys = emalloc(HT_KEYS * sizeof(char *));
+	for (i = 0; i < HT_KEYS; i++)
+	{
+		keys[i] = emalloc(32);
+		sprintf(keys[i], "key%024d", i);
+	}
+
+	start = now_s();
+	for (i = 0; i < HT_KEYS; i++)
+	{
+		if (ht_insert(ht, keys[i], keys[i]) != EXIT_SUCCESS)
+		{
+			eprintf("could not insert a benchmark key");
+		}
+	}
+	for (r = 0; r < HT_ROUNDS; r++)
+	{
+		for (i = 0; i < HT_KEYS; i++)
+		{
+			if (ht_search(ht, keys[i]) == NULL)
+			{
+				eprintf("lost a benchmark key");
+			}
+		}
+	}
+	elapsed = now_s() - start;
+
+	ht_free(ht, free, noop_free);
+	free(keys);
+	release_arena();
+
+	sprintf(metric, "%s.ops_per_sec", name);
+	record(metric, (1.0 + HT_ROUNDS) * HT_KEYS / elapsed);
+}
+
+/**
+ * Times tokenisation of a synthetic corpus of the specified shape.  The
+ * corpus is written to a temporary file once, and then scanned
+ * <code>SCAN_ROUNDS</code> times end to end.
+ *
+ * @param[in] name    the metric name to report under
+ * @param[in] nsubs   the number of subroutines in the corpus
+ * @param[in] nstmts  the number of statements per body
+ * @param[in] depth   the nesting depth of the statement blocks
+ * @param[in] idlen   the number of digits in generated identifiers
+ * @param[in] density the percentage of identifier-heavy statements
+ */
+static void bench_scanner(const char *name, int nsubs, int nstmts, int depth,
+	int idlen, int density)
+{
+	FILE   *corpus;
+	Token	t;
+	char	metric[64];
+	double	start, elapsed;
+	long	ntokens;
+	int		r;
+
+	if ((corpus = tmpfile()) == NULL)
+	{
+		eprintf("could not create a corpus file:");
+	}
+	generate_corpus(corpus, nsubs, nstmts, depth, idlen, density);
+
+	ntokens = 0;
+	start	= now_s();
+	for (r = 0; r < SCAN_ROUNDS; r++)
+	{
+		rewind(corpus);
+		init_scanner(corpus);
+		do
+		{
+			get_token(&t);
+			if (t.type == TOK_STR)
+			{
+				free(t.string);
+			}
+			ntokens++;
+		} while (t.type != TOK_EOF);
+		release_scanner();
+	}
+	elapsed = now_s() - start;
+
+	fclose(corpus);
+
+	sprintf(metric, "%s.tokens_per_sec", name);
+	record(metric, ntokens / elapsed);
+}
+
+/* --- corpus generation ---------------------------------------------------- */
+
+/**
+ * Writes the statement block of one subroutine body, wrapped in the requested
+ * number of nested while loops.
+ *
+ * @param[in] f       the stream to write to
+ * @param[in] indent  the indentation depth to start from
+ * @param[in] nstmts  the number of statements to write
+ * @param[in] depth   the number of nesting levels around the statements
+ * @param[in] idlen   the number of digits in generated identifiers
+ * @param[in] density the percentage of identifier-heavy statements
+ */
+static void emit_body(FILE *f, int indent, int nstmts, int depth, int idlen,
+	int density)
+{
+	int i, d;
+
+	fprintf(f, "%*sint x%0*d, x%0*d, x%0*d;\n", 2 * indent, "", idlen, 0,
+		idlen, 1, idlen, 2);
+	fprintf(f, "%*slet x%0*d = 1;\n", 2 * indent, "", idlen, 0);
+
+	for (d = 0; d < depth; d++)
+	{
+		fprintf(f, "%*swhile x%0*d > %d:\n", 2 * (indent + d), "", idlen, 0,
+			d);
+	}
+
+	for (i = 0; i < nstmts; i++)
+	{
+		if (i % 100 < density)
+		{
+			fprintf(f, "%*slet x%0*d = x%0*d + x%0*d * x%0*d - x%0*d;\n",
+				2 * (indent + depth), "", idlen, i % 3, idlen, (i + 1) % 3,
+				idlen, (i + 2) % 3, idlen, i % 3, idlen, (i + 1) % 3);
+		} else
+		{
+			fprintf(f, "%*slet x%0*d = %d + %d * (%d - x%0*d) {c%d};\n",
+				2 * (indent + depth), "", idlen, i % 3, i, 7919, 104729,
+				idlen, (i + 1) % 3, i);
+		}
+	}
+	fprintf(f, "%*soutput(\"block done: \" .. x%0*d)\n",
+		2 * (indent + depth), "", idlen, 0);
+
+	for (d = depth - 1; d >= 0; d--)
+	{
+		fprintf(f, "%*send\n", 2 * (indent + d), "");
+	}
+}
+
+/**
+ * Writes a synthetic AMPL program of the specified shape.  The program is
+ * lexically well-formed, which is all the scanner benchmark requires.
+ *
+ * @param[in] f       the stream to write to
+ * @param[in] nsubs   the number of subroutines
+ * @param[in] nstmts  the number of statements per body
+ * @param[in] depth   the nesting depth of the statement blocks
+ * @param[in] idlen   the number of digits in generated identifiers
+ * @param[in] density the percentage of identifier-heavy statements
+ */
+static void generate_corpus(FILE *f, int nsubs, int nstmts, int depth,
+	int idlen, int density)
+{
+	int s;
+
+	fprintf(f, "program bench:\n\n");
+
+	for (s = 0; s < nsubs; s++)
+	{
+		fprintf(f, "sub%0*d(int a%0*d, int b%0*d) -> int:\n", idlen, s,
+			idlen, s, idlen, s);
+		emit_body(f, 1, nstmts, depth, idlen, density);
+		fprintf(f, "%*sreturn x%0*d\n\n", 2, "", idlen, 0);
+	}
+
+	fprintf(f, "main:\n");
+	emit_body(f, 1, nstmts, depth, idlen, density);
+}
+
+/* --- reporting ------------------------------------------------------------ */
+
+/**
+ * Gets the current monotonic time in seconds.
+ *
+ * @return the time in seconds
+ */
+static double now_s(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/** Releases nothing; the benchmark values alias their keys. */
+static void noop_free(void *p)
+{
+	(void)p;
+}
+
+/**
+ * Compares two keys by address, mirroring the identity comparison the symbol
+ * table uses for interned identifiers.
+ */
+static int ptr_cmp(void *val1, void *val2)
+{
+	return (val1 < val2 ? -1 : (val1 > val2 ? 1 : 0));
+}
+
+/**
+ * Hashes a key on its address, mirroring the symbol table's hash over
+ * interned identifiers.
+ */
+static unsigned int ptr_hash(void *key, unsigned int size)
+{
+	unsigned long long hash;
+
+	hash = (unsigned long long)(size_t)key * 0x9e3779b97f4a7c15ULL;
+	hash ^= hash >> 32;
+
+	return (hash % size);
+}
+
+/**
+ * Records one metric for the final report.
+ *
+ * @param[in] name  the metric name
+ * @param[in] value the measured operations per second
+ */
+static void record(const char *name, double value)
+{
+	if (nresults == MAX_RESULTS)
+	{
+		eprintf("too many benchmark results");
+	}
+	results[nresults].name	  = estrdup(name);
+	results[nresults++].value = value;
+}
+
+/**
+ * Prints every recorded metric, with the percentage delta against the stored
+ * baseline where one exists, and rewrites the baseline when requested.
+ *
+ * @param[in] update whether to rewrite the baseline from this run
+ */
+static void report(Boolean update)
+{
+	FILE  *f;
+	char   name[64];
+	double base[MAX_RESULTS], value;
+	int	   i, j;
+
+	for (i = 0; i < nresults; i++)
+	{
+		base[i] = 0.0;
+	}
+
+	if ((f = fopen(BASELINE_FILE, "r")) != NULL)
+	{
+		while (fscanf(f, "%63[^=]=%lf\n", name, &value) == 2)
+		{
+			for (j = 0; j < nresults; j++)
+			{
+				if (strcmp(results[j].name, name) == 0)
+				{
+					base[j] = value;
+				}
+			}
+		}
+		fclose(f);
+	}
+
+	for (i = 0; i < nresults; i++)
+	{
+		printf("%-28s %14.0f", results[i].name, results[i].value);
+		if (base[i] > 0.0)
+		{
+			printf("  %+6.1f%% vs baseline",
+				100.0 * (results[i].value - base[i]) / base[i]);
+		}
+		printf("\n");
+	}
+
+	if (update)
+	{
+		if ((f = fopen(BASELINE_FILE, "w")) == NULL)
+		{
+			eprintf("could not write '%s':", BASELINE_FILE);
+		}
+		for (i = 0; i < nresults; i++)
+		{
+			fprintf(f, "%s=%.0f\n", results[i].name, results[i].value);
+		}
+		fclose(f);
+		printf("baseline written to %s\n", BASELINE_FILE);
+	}
+
+	for (i = 0; i < nresults; i++)
+	{
+		free((char *)results[i].name);
+	}
+}
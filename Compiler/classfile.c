@@ -0,0 +1,906 @@
+/**
+ * @file    classfile.c
+ * @brief   Native JVM classfile emission for AMPL-2023.
+ * @date    2023-08-12
+ */
+
+#include "classfile.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "boolean.h"
+#include "error.h"
+
+/* --- classfile constants --------------------------------------------------- */
+
+#define CLASS_MAGIC 0xcafebabe
+#define CLASS_MAJOR 49 /* Java 5: ldc of classes allowed, no stack maps */
+#define CLASS_MINOR 0
+
+#define ACC_PUBLIC 0x0001
+#define ACC_PRIVATE 0x0002
+#define ACC_STATIC 0x0008
+#define ACC_FINAL 0x0010
+#define ACC_SUPER 0x0020
+
+#define CP_UTF8 1
+#define CP_INTEGER 3
+#define CP_CLASS 7
+#define CP_STRING 8
+#define CP_FIELDREF 9
+#define CP_METHODREF 10
+#define CP_NAMEANDTYPE 12
+
+/* the raw opcodes needed beyond the generated instruction set */
+#define OP_NOP 0x00
+#define OP_WIDE 0xc4
+#define OP_ICONST_M1 0x02
+#define OP_ICONST_0 0x03
+#define OP_BIPUSH 0x10
+#define OP_SIPUSH 0x11
+#define OP_LDC 0x12
+#define OP_LDC_W 0x13
+#define OP_ILOAD_0 0x1a
+#define OP_ALOAD_0 0x2a
+#define OP_ISTORE_0 0x3b
+#define OP_ASTORE_0 0x4b
+#define OP_POP 0x57
+#define OP_DUP 0x59
+#define OP_IFEQ 0x99
+#define OP_IRETURN 0xac
+#define OP_RETURN 0xb1
+#define OP_GETSTATIC 0xb2
+#define OP_PUTSTATIC 0xb3
+#define OP_INVOKEVIRTUAL 0xb6
+#define OP_INVOKESPECIAL 0xb7
+#define OP_ATHROW 0xbf
+#define OP_NEW 0xbb
+
+#define MAX_REF_LEN 512
+
+/**
+ * the real JVM opcode for each <code>Bytecode</code> value; the order must
+ * match the enumeration in jvm.h
+ */
+static const unsigned char opmap[] = {
+	0x19, /* aload         */ 0xb0, /* areturn       */
+	0x3a, /* astore        */ 0xb2, /* getstatic     */
+	0xa7, /* goto          */ 0x60, /* iadd          */
+	0x2e, /* iaload        */ 0x7e, /* iand          */
+	0x4f, /* iastore       */ 0x6c, /* idiv          */
+	0x99, /* ifeq          */ 0x9f, /* if_icmpeq     */
+	0xa2, /* if_icmpge     */ 0xa3, /* if_icmpgt     */
+	0xa4, /* if_icmple     */ 0xa1, /* if_icmplt     */
+	0xa0, /* if_icmpne     */ 0x15, /* iload         */
+	0x68, /* imul          */ 0x74, /* ineg          */
+	0xb8, /* invokestatic  */ 0xb6, /* invokevirtual */
+	0x80, /* ior           */ 0x36, /* istore        */
+	0x64, /* isub          */ 0x70, /* irem          */
+	0xac, /* ireturn       */ 0x82, /* ixor          */
+	0x12, /* ldc           */ 0xbc, /* newarray      */
+	0xb1, /* return        */ 0x5f  /* swap          */
+};
+
+/* --- type definitions ------------------------------------------------------ */
+
+typedef unsigned char  u1;
+typedef unsigned short u2;
+typedef unsigned int   u4;
+
+/** a growable big-endian byte buffer */
+typedef struct {
+	u1	  *data;
+	size_t len;
+	size_t cap;
+} ByteBuf;
+
+/** a constant pool entry */
+typedef struct {
+	u1	  tag;
+	u2	  a;   /*<< the first index operand   */
+	u2	  b;   /*<< the second index operand  */
+	int	  num; /*<< the value (CP_INTEGER)    */
+	char *str; /*<< the characters (CP_UTF8)  */
+} CPentry;
+
+/** an assembled method awaiting serialisation */
+typedef struct {
+	u2	   access;
+	u2	   name_idx;
+	u2	   desc_idx;
+	u2	   max_stack;
+	u2	   max_locals;
+	u1	  *code;
+	size_t code_len;
+} MethodInfo;
+
+/** a pending branch whose target label is not yet bound */
+typedef struct {
+	size_t pos; /*<< the code offset of the branch opcode */
+	Label  label;
+} Fixup;
+
+/* --- global static variables ----------------------------------------------- */
+
+static CPentry	   *cp;			/* the constant pool (1-based)   */
+static unsigned int cp_count;	/* the number of entries in use  */
+static unsigned int cp_cap;
+
+static MethodInfo  *methods;
+static unsigned int method_count;
+static unsigned int method_cap;
+
+static char *this_name;		 /* the class name                    */
+static u2	 this_class;	 /* CP index of this class            */
+static u2	 super_class;	 /* CP index of java/lang/Object      */
+static u2	 field_name[3];	 /* CP indices of support field names */
+static u2	 field_desc[3];	 /* CP indices of support field descs */
+
+/* the method currently being assembled */
+static ByteBuf		cur;
+static u2			cur_access, cur_name, cur_desc, cur_stack, cur_locals;
+static size_t	   *label_off; /* label -> code offset + 1; 0 is unbound */
+static unsigned int label_cap;
+static Fixup	   *fixups;
+static unsigned int fixup_count;
+static unsigned int fixup_cap;
+
+/* --- function prototypes --------------------------------------------------- */
+
+static void bb_init(ByteBuf *b);
+static void bb_put1(ByteBuf *b, unsigned int v);
+static void bb_put2(ByteBuf *b, unsigned int v);
+static void bb_put4(ByteBuf *b, unsigned long v);
+static void bb_bytes(ByteBuf *b, const void *p, size_t n);
+static void bb_patch2(ByteBuf *b, size_t pos, unsigned int v);
+
+static u2 cp_add(CPentry e);
+static u2 cp_utf8(const char *s);
+static u2 cp_class_ref(const char *name);
+static u2 cp_string_ref(const char *s);
+static u2 cp_integer(int value);
+static u2 cp_nat(const char *name, const char *desc);
+static u2 cp_fieldref(const char *owner, const char *name, const char *desc);
+static u2 cp_methodref(const char *owner, const char *name, const char *desc);
+
+static void begin_method(u2 access, const char *name, const char *descriptor,
+	int max_stack, int max_locals);
+static void emit_ldc_index(u2 index);
+static void emit_branch_raw(u1 opcode, Label label);
+static void emit_field(u1 opcode, const char *owner, const char *name,
+	const char *desc);
+static void emit_method(u1 opcode, const char *owner, const char *name,
+	const char *desc);
+static void emit_support_members(void);
+
+/* --- class builder interface ----------------------------------------------- */
+
+void cf_init(const char *cname)
+{
+	cp_cap	 = 64;
+	cp		 = emalloc(cp_cap * sizeof(CPentry));
+	cp_count = 0;
+
+	method_cap	 = 8;
+	methods		 = emalloc(method_cap * sizeof(MethodInfo));
+	method_count = 0;
+
+	label_cap = 64;
+	label_off = emalloc(label_cap * sizeof(size_t));
+	fixup_cap = 64;
+	fixups	  = emalloc(fixup_cap * sizeof(Fixup));
+
+	this_name	= estrdup(cname);
+	this_class	= cp_class_ref(cname);
+	super_class = cp_class_ref("java/lang/Object");
+
+	/* "Code" must be in the pool before serialisation */
+	(void)cp_utf8("Code");
+
+	emit_support_members();
+}
+
+void cf_begin_method(const char *name, const char *descriptor, int max_stack,
+	int max_locals)
+{
+	begin_method(ACC_PUBLIC | ACC_STATIC, name, descriptor, max_stack,
+		max_locals);
+}
+
+void cf_label(Label label)
+{
+	unsigned int old_cap;
+
+	if (label >= label_cap)
+	{
+		old_cap = label_cap;
+		while (label >= label_cap)
+		{
+			label_cap *= 2;
+		}
+		label_off = erealloc(label_off, label_cap * sizeof(size_t));
+		/* zero means "not yet bound", so the grown tail must not hold
+		 * whatever erealloc left there */
+		memset(label_off + old_cap, 0,
+			(label_cap - old_cap) * sizeof(size_t));
+	}
+	label_off[label] = cur.len + 1;
+}
+
+void cf_instr(Bytecode opcode)
+{
+	bb_put1(&cur, opmap[opcode]);
+}
+
+void cf_instr_var(Bytecode opcode, int index)
+{
+	u1 base;
+
+	if (index < 0 || index > 0xffff)
+	{
+		eprintf("local variable index %d out of range", index);
+	}
+
+	if (index <= 3)
+	{
+		switch (opcode)
+		{
+			case JVM_ILOAD:	 base = OP_ILOAD_0; break;
+			case JVM_ISTORE: base = OP_ISTORE_0; break;
+			case JVM_ALOAD:	 base = OP_ALOAD_0; break;
+			case JVM_ASTORE: base = OP_ASTORE_0; break;
+			default:		 base = 0; break;
+		}
+		if (base != 0)
+		{
+			bb_put1(&cur, base + index);
+			return;
+		}
+	}
+
+	if (index > 255)
+	{
+		bb_put1(&cur, OP_WIDE);
+		bb_put1(&cur, opmap[opcode]);
+		bb_put2(&cur, index);
+	} else
+	{
+		bb_put1(&cur, opmap[opcode]);
+		bb_put1(&cur, index);
+	}
+}
+
+void cf_instr_branch(Bytecode opcode, Label label)
+{
+	emit_branch_raw(opmap[opcode], label);
+}
+
+void cf_ldc_int(int value)
+{
+	if (value >= -1 && value <= 5)
+	{
+		bb_put1(&cur, OP_ICONST_0 + value);
+	} else if (value >= -128 && value <= 127)
+	{
+		bb_put1(&cur, OP_BIPUSH);
+		bb_put1(&cur, value & 0xff);
+	} else if (value >= -32768 && value <= 32767)
+	{
+		bb_put1(&cur, OP_SIPUSH);
+		bb_put2(&cur, value & 0xffff);
+	} else
+	{
+		emit_ldc_index(cp_integer(value));
+	}
+}
+
+void cf_ldc_string(const char *s)
+{
+	emit_ldc_index(cp_string_ref(s));
+}
+
+void cf_newarray(JVMatype atype)
+{
+	bb_put1(&cur, opmap[JVM_NEWARRAY]);
+	bb_put1(&cur, atype);
+}
+
+void cf_instr_ref(Bytecode opcode, const char *ref)
+{
+	char		owner[MAX_REF_LEN], name[MAX_REF_LEN], desc[MAX_REF_LEN];
+	const char *sep, *stop, *p;
+	size_t		n;
+
+	if (strlen(ref) >= MAX_REF_LEN)
+	{
+		eprintf("reference too long: %s", ref);
+	}
+
+	if (opcode == JVM_GETSTATIC)
+	{
+		/* fields look like "owner/name desc" */
+		stop = strchr(ref, ' ');
+		if (stop == NULL)
+		{
+			eprintf("malformed field reference: %s", ref);
+		}
+		strcpy(desc, stop + 1);
+	} else
+	{
+		/* methods look like "owner/name(args)ret" or "owner.name(args)ret" */
+		stop = strchr(ref, '(');
+		if (stop == NULL)
+		{
+			eprintf("malformed method reference: %s", ref);
+		}
+		strcpy(desc, stop);
+	}
+
+	/* the last separator before the descriptor splits owner from name */
+	sep = NULL;
+	for (p = ref; p < stop; p++)
+	{
+		if (*p == '/' || *p == '.')
+		{
+			sep = p;
+		}
+	}
+	if (sep == NULL)
+	{
+		eprintf("malformed reference: %s", ref);
+	}
+
+	n = sep - ref;
+	memcpy(owner, ref, n);
+	owner[n] = '\0';
+
+	n = stop - (sep + 1);
+	memcpy(name, sep + 1, n);
+	name[n] = '\0';
+
+	if (opcode == JVM_GETSTATIC)
+	{
+		emit_field(OP_GETSTATIC, owner, name, desc);
+	} else
+	{
+		emit_method(opmap[opcode], owner, name, desc);
+	}
+}
+
+void cf_nop(void)
+{
+	bb_put1(&cur, OP_NOP);
+}
+
+void cf_end_method(void)
+{
+	MethodInfo	*m;
+	unsigned int i;
+	size_t		 target;
+	long		 rel;
+
+	for (i = 0; i < fixup_count; i++)
+	{
+		if (fixups[i].label >= label_cap || label_off[fixups[i].label] == 0)
+		{
+			eprintf("undefined branch target L%u", fixups[i].label);
+		}
+		target = label_off[fixups[i].label] - 1;
+		rel	   = (long)target - (long)fixups[i].pos;
+		if (rel < -32768 || rel > 32767)
+		{
+			eprintf("branch offset out of range");
+		}
+		bb_patch2(&cur, fixups[i].pos + 1, (unsigned int)rel & 0xffff);
+	}
+
+	if (method_count == method_cap)
+	{
+		method_cap *= 2;
+		methods = erealloc(methods, method_cap * sizeof(MethodInfo));
+	}
+
+	m			  = &methods[method_count++];
+	m->access	  = cur_access;
+	m->name_idx	  = cur_name;
+	m->desc_idx	  = cur_desc;
+	m->max_stack  = cur_stack;
+	m->max_locals = cur_locals;
+	m->code		  = cur.data;
+	m->code_len	  = cur.len;
+
+	cur.data = NULL;
+	cur.len = cur.cap = 0;
+}
+
+void cf_write_class_file(const char *path)
+{
+	ByteBuf		 out;
+	FILE		*class_file;
+	unsigned int i;
+
+	bb_init(&out);
+
+	bb_put4(&out, CLASS_MAGIC);
+	bb_put2(&out, CLASS_MINOR);
+	bb_put2(&out, CLASS_MAJOR);
+
+	/* constant pool */
+	bb_put2(&out, cp_count + 1);
+	for (i = 1; i <= cp_count; i++)
+	{
+		bb_put1(&out, cp[i].tag);
+		switch (cp[i].tag)
+		{
+			case CP_UTF8:
+				bb_put2(&out, strlen(cp[i].str));
+				bb_bytes(&out, cp[i].str, strlen(cp[i].str));
+				break;
+			case CP_INTEGER:
+				bb_put4(&out, (u4)cp[i].num);
+				break;
+			case CP_CLASS:
+			case CP_STRING:
+				bb_put2(&out, cp[i].a);
+				break;
+			case CP_FIELDREF:
+			case CP_METHODREF:
+			case CP_NAMEANDTYPE:
+				bb_put2(&out, cp[i].a);
+				bb_put2(&out, cp[i].b);
+				break;
+			default:
+				eprintf("unknown constant pool tag %d", cp[i].tag);
+		}
+	}
+
+	bb_put2(&out, ACC_PUBLIC | ACC_SUPER);
+	bb_put2(&out, this_class);
+	bb_put2(&out, super_class);
+
+	/* interfaces */
+	bb_put2(&out, 0);
+
+	/* the three support fields */
+	bb_put2(&out, 3);
+	for (i = 0; i < 3; i++)
+	{
+		bb_put2(&out, ACC_PRIVATE | ACC_STATIC | ACC_FINAL);
+		bb_put2(&out, field_name[i]);
+		bb_put2(&out, field_desc[i]);
+		bb_put2(&out, 0);
+	}
+
+	/* methods, each with a single Code attribute */
+	bb_put2(&out, method_count);
+	for (i = 0; i < method_count; i++)
+	{
+		bb_put2(&out, methods[i].access);
+		bb_put2(&out, methods[i].name_idx);
+		bb_put2(&out, methods[i].desc_idx);
+		bb_put2(&out, 1);
+		bb_put2(&out, cp_utf8("Code"));
+		bb_put4(&out, 12 + methods[i].code_len);
+		bb_put2(&out, methods[i].max_stack);
+		bb_put2(&out, methods[i].max_locals);
+		bb_put4(&out, methods[i].code_len);
+		bb_bytes(&out, methods[i].code, methods[i].code_len);
+		bb_put2(&out, 0); /* exception table   */
+		bb_put2(&out, 0); /* code attributes   */
+	}
+
+	/* class attributes */
+	bb_put2(&out, 0);
+
+	if ((class_file = fopen(path, "wb")) == NULL)
+	{
+		eprintf("Could not open class file:");
+	}
+	if (fwrite(out.data, 1, out.len, class_file) != out.len)
+	{
+		eprintf("Could not write class file:");
+	}
+	fclose(class_file);
+
+	free(out.data);
+}
+
+void cf_release(void)
+{
+	unsigned int i;
+
+	for (i = 1; i <= cp_count; i++)
+	{
+		if (cp[i].tag == CP_UTF8)
+		{
+			free(cp[i].str);
+		}
+	}
+	free(cp);
+	cp		 = NULL;
+	cp_count = 0;
+
+	for (i = 0; i < method_count; i++)
+	{
+		free(methods[i].code);
+	}
+	free(methods);
+	methods		 = NULL;
+	method_count = 0;
+
+	free(label_off);
+	label_off = NULL;
+	free(fixups);
+	fixups = NULL;
+	free(cur.data);
+	cur.data = NULL;
+	free(this_name);
+	this_name = NULL;
+}
+
+/* --- byte buffer utilities ------------------------------------------------- */
+
+static void bb_init(ByteBuf *b)
+{
+	b->cap	= 256;
+	b->len	= 0;
+	b->data = emalloc(b->cap);
+}
+
+static void bb_put1(ByteBuf *b, unsigned int v)
+{
+	if (b->len == b->cap)
+	{
+		b->cap *= 2;
+		b->data = erealloc(b->data, b->cap);
+	}
+	b->data[b->len++] = (u1)(v & 0xff);
+}
+
+static void bb_put2(ByteBuf *b, unsigned int v)
+{
+	bb_put1(b, v >> 8);
+	bb_put1(b, v);
+}
+
+static void bb_put4(ByteBuf *b, unsigned long v)
+{
+	bb_put2(b, (unsigned int)(v >> 16));
+	bb_put2(b, (unsigned int)v);
+}
+
+static void bb_bytes(ByteBuf *b, const void *p, size_t n)
+{
+	size_t i;
+	const u1 *q = p;
+
+	for (i = 0; i < n; i++)
+	{
+		bb_put1(b, q[i]);
+	}
+}
+
+static void bb_patch2(ByteBuf *b, size_t pos, unsigned int v)
+{
+	b->data[pos]	 = (u1)((v >> 8) & 0xff);
+	b->data[pos + 1] = (u1)(v & 0xff);
+}
+
+/* --- constant pool utilities ----------------------------------------------- */
+
+/**
+ * Adds an entry to the constant pool, or returns the index of an identical
+ * existing entry.  The pool is small enough that a linear scan suffices.
+ *
+ * @param[in] e the entry to add
+ * @return the 1-based constant pool index of the entry
+ */
+static u2 cp_add(CPentry e)
+{
+	unsigned int i;
+
+	for (i = 1; i <= cp_count; i++)
+	{
+		if (cp[i].tag != e.tag)
+		{
+			continue;
+		}
+		if (e.tag == CP_UTF8)
+		{
+			if (strcmp(cp[i].str, e.str) == 0)
+			{
+				free(e.str);
+				return i;
+			}
+		} else if (e.tag == CP_INTEGER)
+		{
+			if (cp[i].num == e.num)
+			{
+				return i;
+			}
+		} else if (cp[i].a == e.a && cp[i].b == e.b)
+		{
+			return i;
+		}
+	}
+
+	if (cp_count + 1 == cp_cap)
+	{
+		cp_cap *= 2;
+		cp = erealloc(cp, cp_cap * sizeof(CPentry));
+	}
+
+	cp[++cp_count] = e;
+	if (cp_count >= 0xffff)
+	{
+		eprintf("constant pool overflow");
+	}
+
+	return cp_count;
+}
+
+static u2 cp_utf8(const char *s)
+{
+	CPentry e;
+
+	memset(&e, 0, sizeof(e));
+	e.tag = CP_UTF8;
+	e.str = estrdup(s);
+
+	return cp_add(e);
+}
+
+static u2 cp_class_ref(const char *name)
+{
+	CPentry e;
+
+	memset(&e, 0, sizeof(e));
+	e.tag = CP_CLASS;
+	e.a	  = cp_utf8(name);
+
+	return cp_add(e);
+}
+
+static u2 cp_string_ref(const char *s)
+{
+	CPentry e;
+
+	memset(&e, 0, sizeof(e));
+	e.tag = CP_STRING;
+	e.a	  = cp_utf8(s);
+
+	return cp_add(e);
+}
+
+static u2 cp_integer(int value)
+{
+	CPentry e;
+
+	memset(&e, 0, sizeof(e));
+	e.tag = CP_INTEGER;
+	e.num = value;
+
+	return cp_add(e);
+}
+
+static u2 cp_nat(const char *name, const char *desc)
+{
+	CPentry e;
+
+	memset(&e, 0, sizeof(e));
+	e.tag = CP_NAMEANDTYPE;
+	e.a	  = cp_utf8(name);
+	e.b	  = cp_utf8(desc);
+
+	return cp_add(e);
+}
+
+static u2 cp_fieldref(const char *owner, const char *name, const char *desc)
+{
+	CPentry e;
+
+	memset(&e, 0, sizeof(e));
+	e.tag = CP_FIELDREF;
+	e.a	  = cp_class_ref(owner);
+	e.b	  = cp_nat(name, desc);
+
+	return cp_add(e);
+}
+
+static u2 cp_methodref(const char *owner, const char *name, const char *desc)
+{
+	CPentry e;
+
+	memset(&e, 0, sizeof(e));
+	e.tag = CP_METHODREF;
+	e.a	  = cp_class_ref(owner);
+	e.b	  = cp_nat(name, desc);
+
+	return cp_add(e);
+}
+
+/* --- method assembly utilities --------------------------------------------- */
+
+/**
+ * Starts assembly of a method with the given access flags; the public
+ * cf_begin_method wraps this for the public static methods the code
+ * generator emits.
+ */
+static void begin_method(u2 access, const char *name, const char *descriptor,
+	int max_stack, int max_locals)
+{
+	bb_init(&cur);
+	cur_access = access;
+	cur_name   = cp_utf8(name);
+	cur_desc   = cp_utf8(descriptor);
+	cur_stack  = (u2)max_stack;
+	cur_locals = (u2)max_locals;
+
+	memset(label_off, 0, label_cap * sizeof(size_t));
+	fixup_count = 0;
+}
+
+/**
+ * Emits an ldc or ldc_w of the given constant pool index.
+ */
+static void emit_ldc_index(u2 index)
+{
+	if (index <= 0xff)
+	{
+		bb_put1(&cur, OP_LDC);
+		bb_put1(&cur, index);
+	} else
+	{
+		bb_put1(&cur, OP_LDC_W);
+		bb_put2(&cur, index);
+	}
+}
+
+/**
+ * Emits a branch with a raw opcode and records a fixup for its target.
+ */
+static void emit_branch_raw(u1 opcode, Label label)
+{
+	if (fixup_count == fixup_cap)
+	{
+		fixup_cap *= 2;
+		fixups = erealloc(fixups, fixup_cap * sizeof(Fixup));
+	}
+	fixups[fixup_count].pos	  = cur.len;
+	fixups[fixup_count].label = label;
+	fixup_count++;
+
+	bb_put1(&cur, opcode);
+	bb_put2(&cur, 0);
+}
+
+/**
+ * Emits a field access instruction.
+ */
+static void emit_field(u1 opcode, const char *owner, const char *name,
+	const char *desc)
+{
+	bb_put1(&cur, opcode);
+	bb_put2(&cur, cp_fieldref(owner, name, desc));
+}
+
+/**
+ * Emits a method invocation instruction.
+ */
+static void emit_method(u1 opcode, const char *owner, const char *name,
+	const char *desc)
+{
+	bb_put1(&cur, opcode);
+	bb_put2(&cur, cp_methodref(owner, name, desc));
+}
+
+/**
+ * Emits the class preamble members: the three support fields, the default
+ * constructor, the static initialiser that sets up the shared
+ * java.util.Scanner, and the readInt/readBoolean input helpers.  These mirror
+ * the Jasmin template strings in the code generator.
+ */
+static void emit_support_members(void)
+{
+	char  desc[MAX_REF_LEN];
+	Label l_false, l_exception;
+
+	field_name[0] = cp_utf8("charsetName");
+	field_desc[0] = cp_utf8("Ljava/lang/String;");
+	field_name[1] = cp_utf8("usLocale");
+	field_desc[1] = cp_utf8("Ljava/util/Locale;");
+	field_name[2] = cp_utf8("scanner");
+	field_desc[2] = cp_utf8("Ljava/util/Scanner;");
+
+	/* <clinit> */
+	begin_method(ACC_PUBLIC | ACC_STATIC, "<clinit>", "()V", 5, 1);
+
+	cf_ldc_string("UTF-8");
+	emit_field(OP_PUTSTATIC, this_name, "charsetName", "Ljava/lang/String;");
+
+	bb_put1(&cur, OP_NEW);
+	bb_put2(&cur, cp_class_ref("java/util/Locale"));
+	bb_put1(&cur, OP_DUP);
+	cf_ldc_string("en");
+	cf_ldc_string("US");
+	emit_method(OP_INVOKESPECIAL, "java/util/Locale", "<init>",
+		"(Ljava/lang/String;Ljava/lang/String;)V");
+	emit_field(OP_PUTSTATIC, this_name, "usLocale", "Ljava/util/Locale;");
+
+	bb_put1(&cur, OP_NEW);
+	bb_put2(&cur, cp_class_ref("java/util/Scanner"));
+	bb_put1(&cur, OP_DUP);
+	bb_put1(&cur, OP_NEW);
+	bb_put2(&cur, cp_class_ref("java/io/BufferedInputStream"));
+	bb_put1(&cur, OP_DUP);
+	emit_field(OP_GETSTATIC, "java/lang/System", "in", "Ljava/io/InputStream;");
+	emit_method(OP_INVOKESPECIAL, "java/io/BufferedInputStream", "<init>",
+		"(Ljava/io/InputStream;)V");
+	emit_field(OP_GETSTATIC, this_name, "charsetName", "Ljava/lang/String;");
+	emit_method(OP_INVOKESPECIAL, "java/util/Scanner", "<init>",
+		"(Ljava/io/InputStream;Ljava/lang/String;)V");
+	emit_field(OP_PUTSTATIC, this_name, "scanner", "Ljava/util/Scanner;");
+	emit_field(OP_GETSTATIC, this_name, "scanner", "Ljava/util/Scanner;");
+	emit_field(OP_GETSTATIC, this_name, "usLocale", "Ljava/util/Locale;");
+	emit_method(OP_INVOKEVIRTUAL, "java/util/Scanner", "useLocale",
+		"(Ljava/util/Locale;)Ljava/util/Scanner;");
+	bb_put1(&cur, OP_POP);
+	bb_put1(&cur, OP_RETURN);
+
+	cf_end_method();
+
+	/* <init> */
+	begin_method(ACC_PUBLIC, "<init>", "()V", 1, 1);
+
+	bb_put1(&cur, OP_ALOAD_0);
+	emit_method(OP_INVOKESPECIAL, "java/lang/Object", "<init>", "()V");
+	bb_put1(&cur, OP_RETURN);
+
+	cf_end_method();
+
+	/* readInt */
+	begin_method(ACC_PUBLIC | ACC_STATIC, "readInt", "()I", 1, 1);
+
+	emit_field(OP_GETSTATIC, this_name, "scanner", "Ljava/util/Scanner;");
+	emit_method(OP_INVOKEVIRTUAL, "java/util/Scanner", "nextInt", "()I");
+	bb_put1(&cur, OP_IRETURN);
+
+	cf_end_method();
+
+	/* readBoolean */
+	begin_method(ACC_PUBLIC | ACC_STATIC, "readBoolean", "()Z", 2, 1);
+
+	/* the labels are method-local, so small fixed numbers are safe here */
+	l_false		= 1;
+	l_exception = 2;
+	strcpy(desc, "(Ljava/lang/String;)Z");
+
+	emit_field(OP_GETSTATIC, this_name, "scanner", "Ljava/util/Scanner;");
+	emit_method(OP_INVOKEVIRTUAL, "java/util/Scanner", "next",
+		"()Ljava/lang/String;");
+	bb_put1(&cur, OP_ASTORE_0);
+	bb_put1(&cur, OP_ALOAD_0);
+	cf_ldc_string("true");
+	emit_method(OP_INVOKEVIRTUAL, "java/lang/String", "equalsIgnoreCase", desc);
+	emit_branch_raw(OP_IFEQ, l_false);
+	cf_ldc_int(1);
+	bb_put1(&cur, OP_IRETURN);
+	cf_label(l_false);
+	bb_put1(&cur, OP_ALOAD_0);
+	cf_ldc_string("false");
+	emit_method(OP_INVOKEVIRTUAL, "java/lang/String", "equalsIgnoreCase", desc);
+	emit_branch_raw(OP_IFEQ, l_exception);
+	cf_ldc_int(0);
+	bb_put1(&cur, OP_IRETURN);
+	cf_label(l_exception);
+	bb_put1(&cur, OP_NEW);
+	bb_put2(&cur, cp_class_ref("java/util/InputMismatchException"));
+	bb_put1(&cur, OP_DUP);
+	emit_method(OP_INVOKESPECIAL, "java/util/InputMismatchException", "<init>",
+		"()V");
+	bb_put1(&cur, OP_ATHROW);
+
+	cf_end_method();
+}
@@ -0,0 +1,144 @@
+/**
+ * @file    classfile.h
+ * @brief   Native JVM classfile emission for AMPL-2023.
+ * @date    2023-08-12
+ *
+ * This unit serialises the generated code straight to the binary
+ * <code>.class</code> format, so that compilation no longer depends on
+ * shelling out to the Jasmin assembler.  It understands the same operand
+ * encodings the Jasmin writer uses -- in particular, field and method
+ * references are accepted in the reference-string form the code generator
+ * already produces -- and builds the constant pool, branch offsets, and
+ * runtime-support methods (the scanner setup in <code>&lt;clinit&gt;</code>,
+ * <code>readInt</code>, and <code>readBoolean</code>) itself.
+ */
+
+#ifndef CLASSFILE_H
+#define CLASSFILE_H
+
+#include "codegen.h"
+#include "jvm.h"
+
+/**
+ * Initialise the class builder for the specified class.  This emits the
+ * class preamble: the support fields, the default constructor, the static
+ * initialiser, and the readInt/readBoolean support methods.
+ *
+ * @param[in]  cname
+ *     the name of the class
+ */
+void cf_init(const char *cname);
+
+/**
+ * Begin assembling a public static method.
+ *
+ * @param[in]  name
+ *     the method name
+ * @param[in]  descriptor
+ *     the JVM method descriptor, for example <code>(I[I)V</code>
+ * @param[in]  max_stack
+ *     the operand stack limit for the method
+ * @param[in]  max_locals
+ *     the local variable limit for the method
+ */
+void cf_begin_method(const char *name, const char *descriptor, int max_stack,
+	int max_locals);
+
+/**
+ * Bind a label to the current code position of the open method.
+ *
+ * @param[in]  label
+ *     the label to bind
+ */
+void cf_label(Label label);
+
+/**
+ * Emit an instruction without an operand.
+ *
+ * @param[in]  opcode
+ *     the bytecode instruction
+ */
+void cf_instr(Bytecode opcode);
+
+/**
+ * Emit a local-variable instruction (iload, istore, aload, astore).
+ *
+ * @param[in]  opcode
+ *     the bytecode instruction
+ * @param[in]  index
+ *     the local variable index
+ */
+void cf_instr_var(Bytecode opcode, int index);
+
+/**
+ * Emit a branch instruction; the target label may be bound later in the
+ * same method.
+ *
+ * @param[in]  opcode
+ *     the bytecode instruction
+ * @param[in]  label
+ *     the branch target
+ */
+void cf_instr_branch(Bytecode opcode, Label label);
+
+/**
+ * Emit the cheapest instruction sequence that pushes an integer constant.
+ *
+ * @param[in]  value
+ *     the constant to push
+ */
+void cf_ldc_int(int value);
+
+/**
+ * Emit an ldc of a string constant.
+ *
+ * @param[in]  s
+ *     the string to push
+ */
+void cf_ldc_string(const char *s);
+
+/**
+ * Emit a newarray instruction.
+ *
+ * @param[in]  atype
+ *     the type of the array items
+ */
+void cf_newarray(JVMatype atype);
+
+/**
+ * Emit a field or method access instruction.  The reference is given in the
+ * string form used throughout the code generator: for fields,
+ * <code>owner/name descriptor</code>; for methods,
+ * <code>owner/name(args)ret</code> or <code>owner.name(args)ret</code>.
+ *
+ * @param[in]  opcode
+ *     the bytecode instruction (getstatic, invokestatic, or invokevirtual)
+ * @param[in]  ref
+ *     the reference string
+ */
+void cf_instr_ref(Bytecode opcode, const char *ref);
+
+/**
+ * Emit a nop; used to anchor a label bound at the very end of a method.
+ */
+void cf_nop(void);
+
+/**
+ * Finish the open method: resolve branch offsets and store the method.
+ */
+void cf_end_method(void);
+
+/**
+ * Serialise the class and write it to the specified file in one go.
+ *
+ * @param[in]  path
+ *     the name of the classfile to write
+ */
+void cf_write_class_file(const char *path);
+
+/**
+ * Release all resources held by the class builder.
+ */
+void cf_release(void);
+
+#endif /* CLASSFILE_H */
@@ -6,6 +6,7 @@
  */
 
 #include <assert.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -13,8 +14,10 @@
 #include <sys/wait.h>
 #include <unistd.h>
 #include "boolean.h"
+#include "classfile.h"
 #include "codegen.h"
 #include "error.h"
+#include "profile.h"
 #include "valtypes.h"
 
 /* --- type definitions and constants --------------------------------------- */
@@ -175,15 +178,21 @@ static const char *java_types[]
 #define NBYTECODES (sizeof(instruction_set) / sizeof(BC))
 #define INITIAL_SIZE 1024
 #define JASM_EXT ".jasmin"
+#define CLASS_EXT ".class"
 
 static char *class_name;	/**< the class name                             */
 static char *function_name; /**< the name of current function               */
 static char *jasm_name;		/**< the jasmin file name                       */
+static char *class_file_name; /**< the classfile name                       */
+static char *support_text;	/**< the runtime-support templates, rendered    */
 static int	 code_size;		/**< the current code array size                */
 static int	 ip;			/**< the instruction pointer                    */
 static Body *bodies;		/**< list of function bodies                    */
 static Code *code;			/**< the generated code                         */
 static IDPropt *idprop;		/**< id properties of the current function      */
+static Boolean	optimise;	/**< whether the peephole pass is enabled       */
+static Boolean	check_only; /**< whether code generation is stubbed out     */
+static int		tight_locals; /**< the local limit found by compute_limits  */
 
 int stack_depth, max_stack_depth;
 
@@ -191,6 +200,14 @@ int stack_depth, max_stack_depth;
 
 static void ensure_space(int num_instr);
 static void adjust_stack(BC *instr);
+static void class_method(Body *b);
+static void peephole(void);
+static Boolean fold_code(void);
+static Boolean chain_branches(void);
+static Boolean drop_redundant_gotos(void);
+static void compute_limits(void);
+static void invoke_stack_effect(const char *ref, Boolean has_receiver,
+	int *pop, int *push);
 
 /* --- code generation interface -------------------------------------------- */
 
@@ -198,6 +215,11 @@ void init_code_generation(void) { bodies = NULL; }
 
 void init_subroutine_codegen(const char *name, IDPropt *p)
 {
+	if (check_only)
+	{
+		return;
+	}
+
 	max_stack_depth = stack_depth = 0;
 	ip							  = 0;
 	code						  = emalloc(sizeof(Code) * INITIAL_SIZE);
@@ -206,9 +228,43 @@ void init_subroutine_codegen(const char *name, IDPropt *p)
 	idprop						  = p;
 }
 
+void set_optimise(Boolean flag) { optimise = flag; }
+
+void set_check_only(Boolean flag) { check_only = flag; }
+
+const char *get_class_file_name(void) { return class_file_name; }
+
+const char *get_jasmin_file_name(void) { return jasm_name; }
+
 void close_subroutine_codegen(int varwidth)
 {
+	if (check_only)
+	{
+		return;
+	}
+
 	Body *body, *last;
+	int	  i;
+
+	if (optimise)
+	{
+		peephole();
+	}
+
+	for (i = 0; i < ip; i++)
+	{
+		if ((code[i].type & MASK_TYPE) == CODE_INSTRUCTION)
+		{
+			prof_instrs++;
+		}
+	}
+
+	/* replace the conservative gen-time estimates with computed limits */
+	compute_limits();
+	if (tight_locals < varwidth)
+	{
+		varwidth = tight_locals;
+	}
 
 	body = emalloc(sizeof(Body));
 
@@ -243,7 +299,13 @@ void close_subroutine_codegen(int varwidth)
 
 void set_class_name(char *cname)
 {
+	if (check_only)
+	{
+		return;
+	}
+
 	size_t class_name_len;
+	int	   n;
 
 	class_name	   = estrdup(cname);
 	class_name_len = strlen(class_name);
@@ -253,6 +315,10 @@ void set_class_name(char *cname)
 	strncat(jasm_name, JASM_EXT, sizeof(JASM_EXT));
 
 #pragma GCC diagnostic ignored "-Wsizeof-pointer-memaccess"
+	class_file_name = emalloc(class_name_len + sizeof(CLASS_EXT));
+	strcpy(class_file_name, class_name);
+	strncat(class_file_name, CLASS_EXT, sizeof(CLASS_EXT));
+
 	ref_read_boolean = emalloc(class_name_len + sizeof(REF_READ_BOOLEAN));
 	strcpy(ref_read_boolean, class_name);
 	strncat(ref_read_boolean, REF_READ_BOOLEAN, sizeof(REF_READ_BOOLEAN));
@@ -261,23 +327,48 @@ void set_class_name(char *cname)
 	strcpy(ref_read_integer, class_name);
 	strncat(ref_read_integer, REF_READ_INTEGER, sizeof(REF_READ_INTEGER));
 #pragma GCC diagnostic warning "-Wsizeof-pointer-memaccess"
+
+	/* substitute the class name into the runtime-support templates once, so
+	 * that emission appends ready-made text instead of reformatting the
+	 * templates for every class
+	 */
+	support_text = emalloc(strlen(class_preamble) + strlen(method_init)
+		+ strlen(method_readInt) + strlen(method_readBoolean)
+		+ 9 * class_name_len + 1);
+	n = sprintf(support_text, class_preamble, cname, cname, cname, cname,
+		cname, cname, cname);
+	n += sprintf(support_text + n, "%s", method_init);
+	n += sprintf(support_text + n, method_readInt, cname);
+	sprintf(support_text + n, method_readBoolean, cname);
 }
 
-void assemble(const char *jasmin_path)
+void assemble(const char *jasmin_path, int nfiles, char **jasm_files)
 {
-	int	  status;
-	pid_t pid;
+	int	   status, i;
+	char **args;
+	pid_t  pid;
+
+	/* build the argument vector {"java", "-jar", <jar>, <files ...>, NULL} */
+	args	= emalloc((nfiles + 4) * sizeof(char *));
+	args[0] = "java";
+	args[1] = "-jar";
+	args[2] = (char *)jasmin_path;
+	for (i = 0; i < nfiles; i++)
+	{
+		args[i + 3] = jasm_files[i];
+	}
+	args[nfiles + 3] = NULL;
 
 	if ((pid = fork()) < 0)
 	{
 		eprintf("Could not fork a new process for assembler");
 	} else if (pid == 0) {
-		if (execlp("java", "java", "-jar", jasmin_path, jasm_name, (char *)NULL)
-			< 0)
+		if (execvp("java", args) < 0)
 		{
 			eprintf("Could not exec Jasmin");
 		}
 	}
+	free(args);
 
 	if (waitpid(pid, &status, 0) < 0)
 	{
@@ -294,6 +385,11 @@ void assemble(const char *jasmin_path)
 
 void gen_1(Bytecode opcode)
 {
+	if (check_only)
+	{
+		return;
+	}
+
 	/* TODO */
 	ensure_space(1);
 
@@ -305,6 +401,11 @@ void gen_1(Bytecode opcode)
 
 void gen_2(Bytecode opcode, int operand)
 {
+	if (check_only)
+	{
+		return;
+	}
+
 	ensure_space(2);
 
 	code[ip].type	= CODE_INSTRUCTION;
@@ -318,6 +419,11 @@ void gen_2(Bytecode opcode, int operand)
 
 void gen_call(char *fname, IDPropt *idprop)
 {
+	if (check_only)
+	{
+		return;
+	}
+
 	char		*fpath;
 	unsigned int i;
 
@@ -367,6 +473,11 @@ void gen_call(char *fname, IDPropt *idprop)
 
 void gen_cmp(Bytecode opcode)
 {
+	if (check_only)
+	{
+		return;
+	}
+
 	int l1, l2;
 
 	/* unnecessary to adjust stack depth or to ensure space, since both are
@@ -384,6 +495,11 @@ void gen_cmp(Bytecode opcode)
 
 void gen_label(Label label)
 {
+	if (check_only)
+	{
+		return;
+	}
+
 	ensure_space(1);
 
 	code[ip].type	 = CODE_LABEL;
@@ -392,6 +508,11 @@ void gen_label(Label label)
 
 void gen_2_label(Bytecode opcode, Label label)
 {
+	if (check_only)
+	{
+		return;
+	}
+
 	/* TODO */
 
 	ensure_space(2);
@@ -407,6 +528,11 @@ void gen_2_label(Bytecode opcode, Label label)
 
 void gen_newarray(JVMatype atype)
 {
+	if (check_only)
+	{
+		return;
+	}
+
 	ensure_space(2);
 
 	code[ip].type	= CODE_INSTRUCTION;
@@ -420,6 +546,11 @@ void gen_newarray(JVMatype atype)
 
 void gen_print(ValType type)
 {
+	if (check_only)
+	{
+		return;
+	}
+
 	ensure_space(5);
 
 	code[ip].type	= CODE_INSTRUCTION;
@@ -455,6 +586,11 @@ void gen_print(ValType type)
 
 void gen_print_string(char *string)
 {
+	if (check_only)
+	{
+		return;
+	}
+
 	ensure_space(6);
 
 	code[ip].type	= CODE_INSTRUCTION;
@@ -482,6 +618,11 @@ void gen_print_string(char *string)
 
 void gen_read(ValType type)
 {
+	if (check_only)
+	{
+		return;
+	}
+
 	ensure_space(2);
 
 	code[ip].type	= CODE_INSTRUCTION;
@@ -518,38 +659,83 @@ const char *get_opcode_string(Bytecode opcode)
 
 /* --- code dumping --------------------------------------------------------- */
 
-static void dump_code(FILE *file);
-static void dump_method(FILE *file, Body *b);
-static void dump_preamble(FILE *file, char *name);
+/** a growable output buffer, flushed in one write */
+typedef struct {
+	char  *data;
+	size_t len;
+	size_t cap;
+} OutBuf;
+
+static void out_init(OutBuf *out);
+static void out_puts(OutBuf *out, const char *s);
+static void out_printf(OutBuf *out, const char *fmt, ...);
+static void render_code(OutBuf *out);
+static void render_method(OutBuf *out, Body *b);
+
+void list_code(void)
+{
+	OutBuf out;
 
-void list_code(void) { dump_code(stdout); }
+	out_init(&out);
+	render_code(&out);
+	fwrite(out.data, 1, out.len, stdout);
+	free(out.data);
+}
 
-void dump_code(FILE *obj_file)
+/**
+ * Renders the whole object file -- the pre-rendered runtime-support text
+ * followed by every method -- into the output buffer.
+ *
+ * @param[in] out the output buffer
+ */
+static void render_code(OutBuf *out)
 {
 	Body *b;
 
-	/* preamble */
-	dump_preamble(obj_file, class_name);
+	/* preamble: substituted into the templates once, in set_class_name */
+	out_puts(out, support_text);
 
-	/* dump the methods */
+	/* render the methods */
 	for (b = bodies; b; b = b->next)
 	{
-		dump_method(obj_file, b);
+		render_method(out, b);
 	}
 }
 
 void make_code_file(void)
 {
-	FILE *obj_file;
+	FILE  *obj_file;
+	OutBuf out;
+
+	out_init(&out);
+	render_code(&out);
 
 	if ((obj_file = fopen(jasm_name, "w")) == NULL)
 	{
 		eprintf("Could not open code file:");
 	}
-
-	dump_code(obj_file);
+	if (fwrite(out.data, 1, out.len, obj_file) != out.len)
+	{
+		eprintf("Could not write code file:");
+	}
 
 	fclose(obj_file);
+	free(out.data);
+}
+
+void make_class_file(void)
+{
+	Body *b;
+
+	cf_init(class_name);
+
+	for (b = bodies; b; b = b->next)
+	{
+		class_method(b);
+	}
+
+	cf_write_class_file(class_file_name);
+	cf_release();
 }
 
 /* --- utility functions ---------------------------------------------------- */
@@ -560,6 +746,7 @@ static void ensure_space(int num_instr)
 	{
 		code = erealloc(code, code_size * 2 * sizeof(Code));
 		code_size *= 2;
+		prof_code_growths++;
 	}
 }
 
@@ -580,12 +767,12 @@ static void adjust_stack(BC *instr)
 }
 
 /**
- * Writes a method to the Jasmin output file.
+ * Renders a method into the output buffer.
  *
- * @param[in] file the output file.
- * @param[in] b    the body of the method
+ * @param[in] out the output buffer.
+ * @param[in] b   the body of the method
  */
-static void dump_method(FILE *file, Body *b)
+static void render_method(OutBuf *out, Body *b)
 {
 	int			 i;
 	unsigned int k;
@@ -593,25 +780,25 @@ static void dump_method(FILE *file, Body *b)
 	if (strcmp(b->name, "main") == 0)
 	{
 
-		fprintf(file, ".method public static main([Ljava/lang/String;)V\n");
+		out_puts(out, ".method public static main([Ljava/lang/String;)V\n");
 
 	} else {
 
-		fprintf(file, ".method public static %s(", b->name);
+		out_printf(out, ".method public static %s(", b->name);
 		for (k = 0; k < b->idprop->nparams; k++)
 		{
 			if (IS_ARRAY(b->idprop->params[k]))
 			{
-				fputs("[", file);
+				out_puts(out, "[");
 			}
-			fputs("I", file);
+			out_puts(out, "I");
 		}
-		fprintf(file, ")%s%s\n",
+		out_printf(out, ")%s%s\n",
 			(IS_ARRAY_TYPE(b->idprop->type) ? "[" : ""),
 			(b->idprop->type == TYPE_CALLABLE ? "V" : "I"));
 	}
-	fprintf(file, ".limit stack %d\n", b->max_stack_depth);
-	fprintf(file, ".limit locals %d\n", b->variables_width);
+	out_printf(out, ".limit stack %d\n", b->max_stack_depth);
+	out_printf(out, ".limit locals %d\n", b->variables_width);
 
 	for (i = 0; i < b->ip; i++)
 	{
@@ -621,13 +808,14 @@ static void dump_method(FILE *file, Body *b)
 		switch (c.type & MASK_TYPE)
 		{
 			case CODE_LABEL:
-				fprintf(file, "L%d:\n", c.label);
+				out_printf(out, "L%d:\n", c.label);
 				break;
 			case CODE_LABEL | CODE_OPERAND:
-				fprintf(file, " L%d\n", c.label);
+				out_printf(out, " L%d\n", c.label);
 				break;
 			case CODE_INSTRUCTION:
-				fprintf(file, "\t%s", get_opcode_string(c.code));
+				out_puts(out, "\t");
+				out_puts(out, get_opcode_string(c.code));
 				switch (c.code)
 				{
 					case JVM_ARETURN:
@@ -646,7 +834,7 @@ static void dump_method(FILE *file, Body *b)
 					case JVM_RETURN:
 					case JVM_SWAP:
 						/* emit linefeed */
-						fprintf(file, "\n");
+						out_puts(out, "\n");
 						break;
 					default:
 						/* no linefeed */
@@ -657,16 +845,17 @@ static void dump_method(FILE *file, Body *b)
 				switch (c.type & MASK_DATA_TYPE)
 				{
 					case CODE_ARRAY_TYPE:
-						fprintf(file, " %s\n", java_types[c.atype - T_BOOLEAN]);
+						out_printf(out, " %s\n",
+							java_types[c.atype - T_BOOLEAN]);
 						break;
 					case CODE_INTEGER:
-						fprintf(file, " %d\n", c.num);
+						out_printf(out, " %d\n", c.num);
 						break;
 					case CODE_REFERENCE:
-						fprintf(file, " %s\n", c.string);
+						out_printf(out, " %s\n", c.string);
 						break;
 					case CODE_STRING:
-						fprintf(file, " \"%s\"\n", c.string);
+						out_printf(out, " \"%s\"\n", c.string);
 						break;
 					default:
 						weprintf("Unknown data type for bytecode: %x\n",
@@ -682,37 +871,680 @@ static void dump_method(FILE *file, Body *b)
 	/* guard against a dangling label at the end of the code stream */
 	if ((b->code[b->ip-1].type & MASK_TYPE) == CODE_LABEL)
 	{
-		fprintf(file, "\tnop\n");
+		out_puts(out, "\tnop\n");
+	}
+
+	out_puts(out, ".end method\n\n");
+}
+
+/**
+ * Appends formatted text to the output buffer, growing it as needed.
+ *
+ * @param[in] out the output buffer
+ * @param[in] fmt the printf-style format string
+ */
+static void out_printf(OutBuf *out, const char *fmt, ...)
+{
+	va_list ap;
+	int		n;
+
+	for (;;)
+	{
+		va_start(ap, fmt);
+		n = vsnprintf(out->data + out->len, out->cap - out->len, fmt, ap);
+		va_end(ap);
+
+		if (n < 0)
+		{
+			eprintf("Could not format object code");
+		}
+		if ((size_t)n < out->cap - out->len)
+		{
+			out->len += n;
+			return;
+		}
+
+		while ((size_t)n >= out->cap - out->len)
+		{
+			out->cap *= 2;
+		}
+		out->data = erealloc(out->data, out->cap);
+	}
+}
+
+/**
+ * Appends a string to the output buffer, growing it as needed.
+ *
+ * @param[in] out the output buffer
+ * @param[in] s   the string to append
+ */
+static void out_puts(OutBuf *out, const char *s)
+{
+	size_t n;
+
+	n = strlen(s);
+	if (n >= out->cap - out->len)
+	{
+		while (n >= out->cap - out->len)
+		{
+			out->cap *= 2;
+		}
+		out->data = erealloc(out->data, out->cap);
+	}
+	memcpy(out->data + out->len, s, n + 1);
+	out->len += n;
+}
+
+/**
+ * Initialises the output buffer with enough room for a typical class, so that
+ * most emissions never grow it.
+ *
+ * @param[in] out the output buffer
+ */
+static void out_init(OutBuf *out)
+{
+	out->cap  = 16384;
+	out->len  = 0;
+	out->data = emalloc(out->cap);
+}
+
+/* cell matchers for the peephole pass */
+#define IS_INSTR(c, op) \
+	((((c).type & MASK_TYPE) == CODE_INSTRUCTION) && (c).code == (op))
+#define IS_INT_OPERAND(c) \
+	(((c).type & (MASK_TYPE | MASK_DATA_TYPE)) == (CODE_OPERAND | CODE_INTEGER))
+#define IS_LABEL_OPERAND(c) \
+	(((c).type & MASK_TYPE) == (CODE_LABEL | CODE_OPERAND))
+#define IS_BOUND_LABEL(c) (((c).type & MASK_TYPE) == CODE_LABEL)
+
+/**
+ * Runs the peephole optimizer over the code array of the current subroutine.
+ * The individual passes enable one another -- folding a constant may leave a
+ * branch to a branch, and chaining branches may leave a goto to the next
+ * instruction -- so they are iterated to a fixed point; each pass only ever
+ * shrinks the code, so termination is guaranteed.
+ */
+static void peephole(void)
+{
+	Boolean changed;
+
+	do
+	{
+		changed = fold_code();
+		changed = (chain_branches() ? TRUE : changed);
+		changed = (drop_redundant_gotos() ? TRUE : changed);
+	} while (changed);
+}
+
+/**
+ * Folds constant expressions and removes locally redundant instructions in a
+ * single left-to-right scan.  Reduced windows are re-examined, so cascades
+ * like the code for <code>1 + 2 + 3</code> collapse in one pass.  Divisions
+ * by a constant zero are left alone so that the fault still occurs at run
+ * time.  True dead-store elimination needs liveness information -- and a pop
+ * instruction this subset of the JVM does not use -- so only the no-op form,
+ * a load immediately stored back to the same variable, is removed here.
+ *
+ * @return TRUE if any window was reduced, FALSE otherwise
+ */
+static Boolean fold_code(void)
+{
+	Boolean changed;
+	int		r, w, a, b, v;
+
+	changed = FALSE;
+	w		= 0;
+
+	for (r = 0; r < ip; r++)
+	{
+		code[w++] = code[r];
+
+		for (;;)
+		{
+			/* ldc a; ldc b; <arith>  ==>  ldc (a op b) */
+			if (w >= 5 && IS_INSTR(code[w - 5], JVM_LDC)
+				&& IS_INT_OPERAND(code[w - 4]) && IS_INSTR(code[w - 3], JVM_LDC)
+				&& IS_INT_OPERAND(code[w - 2])
+				&& ((code[w - 1].type & MASK_TYPE) == CODE_INSTRUCTION))
+			{
+				a = code[w - 4].num;
+				b = code[w - 2].num;
+
+				switch (code[w - 1].code)
+				{
+					case JVM_IADD: v = a + b; break;
+					case JVM_ISUB: v = a - b; break;
+					case JVM_IMUL: v = a * b; break;
+					case JVM_IAND: v = a & b; break;
+					case JVM_IOR:  v = a | b; break;
+					case JVM_IXOR: v = a ^ b; break;
+					case JVM_IDIV:
+						if (b == 0)
+						{
+							goto no_arith;
+						}
+						v = a / b;
+						break;
+					case JVM_IREM:
+						if (b == 0)
+						{
+							goto no_arith;
+						}
+						v = a % b;
+						break;
+					default:
+						goto no_arith;
+				}
+
+				code[w - 4].num = v;
+				w -= 3;
+				changed = TRUE;
+				continue;
+			}
+no_arith:
+
+			/* ldc a; ineg  ==>  ldc -a */
+			if (w >= 3 && IS_INSTR(code[w - 3], JVM_LDC)
+				&& IS_INT_OPERAND(code[w - 2]) && IS_INSTR(code[w - 1], JVM_INEG))
+			{
+				code[w - 2].num = -code[w - 2].num;
+				w -= 1;
+				changed = TRUE;
+				continue;
+			}
+
+			/* identities: x+0, x-0, x|0, x^0, x*1, x/1  ==>  x */
+			if (w >= 3 && IS_INSTR(code[w - 3], JVM_LDC)
+				&& IS_INT_OPERAND(code[w - 2])
+				&& ((code[w - 1].type & MASK_TYPE) == CODE_INSTRUCTION))
+			{
+				v = code[w - 2].num;
+				switch (code[w - 1].code)
+				{
+					case JVM_IADD:
+					case JVM_ISUB:
+					case JVM_IOR:
+					case JVM_IXOR:
+						if (v == 0)
+						{
+							w -= 3;
+							changed = TRUE;
+							continue;
+						}
+						break;
+					case JVM_IMUL:
+					case JVM_IDIV:
+						if (v == 1)
+						{
+							w -= 3;
+							changed = TRUE;
+							continue;
+						}
+						break;
+					default:
+						break;
+				}
+			}
+
+			/* iload n; istore n  ==>  (nothing) */
+			if (w >= 4 && IS_INSTR(code[w - 4], JVM_ILOAD)
+				&& IS_INT_OPERAND(code[w - 3]) && IS_INSTR(code[w - 2], JVM_ISTORE)
+				&& IS_INT_OPERAND(code[w - 1])
+				&& code[w - 3].num == code[w - 1].num)
+			{
+				w -= 4;
+				changed = TRUE;
+				continue;
+			}
+
+			break;
+		}
+	}
+
+	ip = w;
+
+	return changed;
+}
+
+/**
+ * Retargets branches whose destination is an unconditional goto straight to
+ * the final destination.  Chains are followed with a hop limit so that cycles
+ * (an empty infinite loop) cannot hang the pass.
+ *
+ * @return TRUE if any branch was retargeted, FALSE otherwise
+ */
+static Boolean chain_branches(void)
+{
+	Boolean changed;
+	Label	max, l, *target;
+	int		i, j, hops;
+
+	max = 0;
+	for (i = 0; i < ip; i++)
+	{
+		if ((code[i].type & CODE_LABEL) && code[i].label > max)
+		{
+			max = code[i].label;
+		}
+	}
+	if (max == 0)
+	{
+		return FALSE;
+	}
+
+	target = emalloc((max + 1) * sizeof(Label));
+	memset(target, 0, (max + 1) * sizeof(Label));
+
+	/* map every label bound directly in front of a goto to its target */
+	for (i = 0; i < ip; i++)
+	{
+		if (!IS_BOUND_LABEL(code[i]))
+		{
+			continue;
+		}
+		j = i + 1;
+		while (j < ip && IS_BOUND_LABEL(code[j]))
+		{
+			j++;
+		}
+		if (j + 1 < ip && IS_INSTR(code[j], JVM_GOTO)
+			&& IS_LABEL_OPERAND(code[j + 1]))
+		{
+			target[code[i].label] = code[j + 1].label;
+		}
 	}
 
-	fprintf(file, ".end method\n\n");
+	changed = FALSE;
+	for (i = 0; i < ip; i++)
+	{
+		if (!IS_LABEL_OPERAND(code[i]))
+		{
+			continue;
+		}
+		l = code[i].label;
+		for (hops = 0; hops < 8 && target[l] != 0 && target[l] != l; hops++)
+		{
+			l = target[l];
+		}
+		if (l != code[i].label)
+		{
+			code[i].label = l;
+			changed		  = TRUE;
+		}
+	}
+
+	free(target);
+
+	return changed;
 }
 
 /**
- * Writes the preamble to the Jasmin output file.  The preamble consists of (i)
- * the class name and visibility specifier, (ii) the superclass, and (iii) the
- * default initialiser (constructor).
+ * Removes goto instructions whose target label is bound immediately after
+ * them, with only other label bindings in between.
  *
- * @param[in] file the output file.
- * @param[in] name the name of the class.
+ * @return TRUE if any goto was removed, FALSE otherwise
  */
-static void dump_preamble(FILE *file, char *name)
+static Boolean drop_redundant_gotos(void)
 {
-	fprintf(file, class_preamble, name, name, name, name, name, name, name);
-	fputs(method_init, file);
-	fprintf(file, method_readInt, name);
-	fprintf(file, method_readBoolean, name);
+	Boolean changed, redundant;
+	int		r, w, j;
+
+	changed = FALSE;
+	w		= 0;
+
+	for (r = 0; r < ip; r++)
+	{
+		if (r + 1 < ip && IS_INSTR(code[r], JVM_GOTO)
+			&& IS_LABEL_OPERAND(code[r + 1]))
+		{
+			redundant = FALSE;
+			for (j = r + 2; j < ip && IS_BOUND_LABEL(code[j]); j++)
+			{
+				if (code[j].label == code[r + 1].label)
+				{
+					redundant = TRUE;
+					break;
+				}
+			}
+			if (redundant)
+			{
+				r++; /* skip the operand cell as well */
+				changed = TRUE;
+				continue;
+			}
+		}
+		code[w++] = code[r];
+	}
+
+	ip = w;
+
+	return changed;
 }
 
+/**
+ * Determines the exact stack effect of an invoke instruction from its
+ * reference string by counting the argument slots in the descriptor.
+ *
+ * @param[in]  ref          the reference string, "owner/name(args)ret"
+ * @param[in]  has_receiver whether the call pops an object reference as well
+ * @param[out] pop          the number of slots popped
+ * @param[out] push         the number of slots pushed
+ */
+static void invoke_stack_effect(const char *ref, Boolean has_receiver,
+	int *pop, int *push)
+{
+	const char *p;
+
+	*pop  = (has_receiver ? 1 : 0);
+	*push = 0;
+
+	if ((p = strchr(ref, '(')) == NULL)
+	{
+		weprintf("Malformed invoke reference: %s\n", ref);
+		return;
+	}
+
+	for (p++; *p != '\0' && *p != ')';)
+	{
+		if (*p == '[')
+		{
+			p++; /* the array counts at its element type */
+			continue;
+		}
+		if (*p == 'L')
+		{
+			while (*p != '\0' && *p != ';')
+			{
+				p++;
+			}
+		}
+		if (*p != '\0')
+		{
+			p++;
+		}
+		(*pop)++;
+	}
+
+	if (*p == ')' && *(p + 1) != 'V' && *(p + 1) != '\0')
+	{
+		*push = 1;
+	}
+}
+
+/**
+ * Computes the exact maximum operand-stack depth and the tight local-variable
+ * limit of the current subroutine by a worklist dataflow walk over the code
+ * array.  Paths are followed across branches through the label bindings; the
+ * depth recorded at every reached cell makes the walk terminate, since a cell
+ * is only enqueued the first time it is reached, and joining paths must agree
+ * on the depth.  The results land in <code>max_stack_depth</code> and
+ * <code>tight_locals</code>, replacing the conservative per-instruction
+ * estimates accumulated by <code>adjust_stack</code>.
+ */
+static void compute_limits(void)
+{
+	Label  max_label, l;
+	int	  *label_cell, *depth_at, *worklist;
+	int	   n_work, i, j, d, nd, pop, push, maxd;
+	Boolean has_operand;
+
+	tight_locals = (strcmp(function_name, "main") == 0
+			? 1 : (int)idprop->nparams);
+
+	if (ip == 0)
+	{
+		max_stack_depth = 0;
+		return;
+	}
+
+	/* map every bound label to its cell */
+	max_label = 0;
+	for (i = 0; i < ip; i++)
+	{
+		if ((code[i].type & CODE_LABEL) && code[i].label > max_label)
+		{
+			max_label = code[i].label;
+		}
+	}
+	label_cell = emalloc((max_label + 1) * sizeof(int));
+	for (l = 0; l <= max_label; l++)
+	{
+		label_cell[l] = -1;
+	}
+	for (i = 0; i < ip; i++)
+	{
+		if (IS_BOUND_LABEL(code[i]))
+		{
+			label_cell[code[i].label] = i;
+		}
+	}
+
+	depth_at = emalloc(ip * sizeof(int));
+	for (i = 0; i < ip; i++)
+	{
+		depth_at[i] = -1;
+	}
+	worklist = emalloc(ip * sizeof(int));
+
+	/* enqueue the entry point at depth zero */
+	depth_at[0] = 0;
+	worklist[0] = 0;
+	n_work		= 1;
+	maxd		= 0;
+
+	while (n_work > 0)
+	{
+		i = worklist[--n_work];
+		d = depth_at[i];
+
+		if (IS_BOUND_LABEL(code[i]))
+		{
+			i++; /* step over the binding itself */
+		}
+
+		while (i < ip)
+		{
+			if (IS_BOUND_LABEL(code[i]))
+			{
+				/* hand the rest of this path over to the label's entry */
+				if (depth_at[i] == -1)
+				{
+					depth_at[i]		  = d;
+					worklist[n_work++] = i;
+				} else if (depth_at[i] != d) {
+					weprintf("Stack depth mismatch at L%u\n", code[i].label);
+				}
+				break;
+			}
+
+			has_operand = (i + 1 < ip && (code[i + 1].type & CODE_OPERAND))
+				? TRUE : FALSE;
+
+			switch (code[i].code)
+			{
+				case JVM_INVOKESTATIC:
+					invoke_stack_effect(code[i + 1].string, FALSE, &pop,
+						&push);
+					break;
+				case JVM_INVOKEVIRTUAL:
+					invoke_stack_effect(code[i + 1].string, TRUE, &pop,
+						&push);
+					break;
+				default:
+					pop	 = instruction_set[code[i].code].pop;
+					push = instruction_set[code[i].code].push;
+					break;
+			}
+
+			if (d < pop)
+			{
+				weprintf("Operand stack underflow in %s\n", function_name);
+			}
+			nd = d - pop + push;
+			if (nd > maxd)
+			{
+				maxd = nd;
+			}
+			d = nd;
+
+			/* track the highest local variable slot actually touched */
+			if (has_operand && IS_INT_OPERAND(code[i + 1])
+				&& (code[i].code == JVM_ILOAD || code[i].code == JVM_ISTORE
+					|| code[i].code == JVM_ALOAD || code[i].code == JVM_ASTORE)
+				&& code[i + 1].num + 1 > tight_locals)
+			{
+				tight_locals = code[i + 1].num + 1;
+			}
+
+			if (has_operand && IS_LABEL_OPERAND(code[i + 1]))
+			{
+				l = code[i + 1].label;
+				j = (l <= max_label ? label_cell[l] : -1);
+				if (j == -1)
+				{
+					weprintf("Branch to unbound label L%u\n", l);
+				} else if (depth_at[j] == -1)
+				{
+					depth_at[j]		   = d;
+					worklist[n_work++] = j;
+				} else if (depth_at[j] != d) {
+					weprintf("Stack depth mismatch at L%u\n", l);
+				}
+
+				if (code[i].code == JVM_GOTO)
+				{
+					break;
+				}
+			}
+
+			if (code[i].code == JVM_RETURN || code[i].code == JVM_IRETURN
+				|| code[i].code == JVM_ARETURN)
+			{
+				break;
+			}
+
+			i += (has_operand ? 2 : 1);
+		}
+	}
+
+	max_stack_depth = maxd;
+
+	free(label_cell);
+	free(depth_at);
+	free(worklist);
+}
+
+/**
+ * Assembles a method directly into the class builder.  This mirrors
+ * <code>dump_method</code>, but hands the instruction stream to the classfile
+ * unit instead of rendering Jasmin text.
+ *
+ * @param[in] b the body of the method
+ */
+static void class_method(Body *b)
+{
+	char		*descriptor, *d;
+	int			 i;
+	unsigned int k;
+
+	descriptor = emalloc(2 * b->idprop->nparams + sizeof("([Ljava/lang/String;)V"));
+
+	if (strcmp(b->name, "main") == 0)
+	{
+		strcpy(descriptor, "([Ljava/lang/String;)V");
+	} else {
+		d	 = descriptor;
+		*d++ = '(';
+		for (k = 0; k < b->idprop->nparams; k++)
+		{
+			if (IS_ARRAY(b->idprop->params[k]))
+			{
+				*d++ = '[';
+			}
+			*d++ = 'I';
+		}
+		*d++ = ')';
+		if (IS_ARRAY_TYPE(b->idprop->type))
+		{
+			*d++ = '[';
+		}
+		*d++ = (b->idprop->type == TYPE_CALLABLE ? 'V' : 'I');
+		*d	 = '\0';
+	}
+
+	cf_begin_method(b->name, descriptor, b->max_stack_depth,
+		b->variables_width);
+	free(descriptor);
+
+	for (i = 0; i < b->ip; i++)
+	{
+
+		Code c = b->code[i];
+
+		switch (c.type & MASK_TYPE)
+		{
+			case CODE_LABEL:
+				cf_label(c.label);
+				break;
+			case CODE_INSTRUCTION:
+				if (i + 1 < b->ip && (b->code[i + 1].type & CODE_OPERAND))
+				{
+					Code op = b->code[++i];
+
+					if ((op.type & MASK_TYPE) == (CODE_LABEL | CODE_OPERAND))
+					{
+						cf_instr_branch(c.code, op.label);
+						break;
+					}
+					switch (op.type & MASK_DATA_TYPE)
+					{
+						case CODE_ARRAY_TYPE:
+							cf_newarray(op.atype);
+							break;
+						case CODE_INTEGER:
+							if (c.code == JVM_LDC)
+							{
+								cf_ldc_int(op.num);
+							} else {
+								cf_instr_var(c.code, op.num);
+							}
+							break;
+						case CODE_REFERENCE:
+							cf_instr_ref(c.code, op.string);
+							break;
+						case CODE_STRING:
+							cf_ldc_string(op.string);
+							break;
+						default:
+							weprintf("Unknown data type for bytecode: %x\n",
+								(unsigned int)op.type);
+					}
+				} else {
+					cf_instr(c.code);
+				}
+				break;
+			default:
+				weprintf("Unknown operator for bytecode: %x\n",
+					(unsigned int)c.type);
+		}
+	}
+
+	/* guard against a dangling label at the end of the code stream */
+	if ((b->code[b->ip-1].type & MASK_TYPE) == CODE_LABEL)
+	{
+		cf_nop();
+	}
+
+	cf_end_method();
+}
+
+
 void release_code_generation(void)
 {
 	/*int i;*/
 	Body *b, *d;
 
-	/* remove Jasmin file */
-#ifndef DEBUG_CODEGEN
-	unlink(jasm_name);
-#endif
+	/* the Jasmin file, if any, is removed by the driver after assembly */
 
 	/* free bodies */
 	/* TODO */
@@ -736,14 +1568,7 @@ void release_code_generation(void)
 			free(d->code);
 		}
 
-		if (d->idprop)
-		{
-			if (d->idprop->params)
-			{
-				free(d->idprop->params);
-			}
-			free(d->idprop);
-		}
+		/* d->idprop and its params are arena-allocated by the parser */
 
 		free(d);
 	}
@@ -753,6 +1578,8 @@ void release_code_generation(void)
 	/* TODO */
 	free(class_name);
 	free(jasm_name);
+	free(class_file_name);
+	free(support_text);
 	free(ref_read_boolean);
 	free(ref_read_integer);
 }
@@ -15,13 +15,18 @@
 typedef unsigned int Label;
 
 /**
- * Assemble a Jasmin file.  The file must first be written by calling
- * <code>make_code_file</code>.
+ * Assemble a batch of Jasmin files with a single Jasmin invocation.  The
+ * files must first have been written by calling <code>make_code_file</code>;
+ * batching them pays for one JVM start-up per run rather than one per file.
  *
  * @param[in]  jasmin_path
  *     the path to the Jasmin JAR file
+ * @param[in]  nfiles
+ *     the number of Jasmin files to assemble
+ * @param[in]  jasm_files
+ *     the names of the Jasmin files
  */
-void assemble(const char *jasmin_path);
+void assemble(const char *jasmin_path, int nfiles, char **jasm_files);
 
 /**
  * Close the code generation for the current function or procedure.
@@ -142,6 +147,26 @@ Label get_label(void);
  */
 const char *get_opcode_string(Bytecode opcode);
 
+/**
+ * Get the name of the classfile artifact of the current compilation.  This is
+ * only valid between <code>set_class_name</code> and
+ * <code>release_code_generation</code>.
+ *
+ * @return
+ *     the name of the classfile
+ */
+const char *get_class_file_name(void);
+
+/**
+ * Get the name of the Jasmin file of the current compilation.  This is only
+ * valid between <code>set_class_name</code> and
+ * <code>release_code_generation</code>.
+ *
+ * @return
+ *     the name of the Jasmin file
+ */
+const char *get_jasmin_file_name(void);
+
 /**
  * Initialise the code generation unit.
  */
@@ -163,11 +188,38 @@ void init_subroutine_codegen(const char *name, IDPropt *p);
  */
 void list_code(void);
 
+/**
+ * Write the generated code straight to a binary classfile.  This is the
+ * default backend; <code>make_code_file</code> and <code>assemble</code>
+ * remain available as a debugging path for inspecting Jasmin output.
+ */
+void make_class_file(void);
+
 /**
  * Open the object file, and write the generated code to it.
  */
 void make_code_file(void);
 
+/**
+ * Enable or disable check-only mode.  When enabled, every code generation
+ * entry point returns immediately, so a compilation performs syntax and type
+ * validation at scanner-and-parser cost only, and produces no artifact.
+ *
+ * @param[in]  flag
+ *     <code>TRUE</code> to stub out code generation
+ */
+void set_check_only(Boolean flag);
+
+/**
+ * Enable or disable the peephole optimizer.  When enabled, every subroutine's
+ * code array is rewritten -- constants folded, branch chains collapsed,
+ * locally redundant instructions removed -- as the subroutine is closed.
+ *
+ * @param[in]  flag
+ *     <code>TRUE</code> to optimise the generated code
+ */
+void set_optimise(Boolean flag);
+
 /**
  * Set the name of the class file.  This must be called after
  * <code>init_code_generation</code>, but before any other code is emitted.
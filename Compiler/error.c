@@ -85,6 +85,13 @@ SourcePos position;
 #ifndef __APPLE__
 static char *pname = NULL;
 #endif
+
+/* The source name lives in a preallocated buffer, so that setting and
+ * clearing it between compilations costs no allocation; overlong names are
+ * truncated for display.
+ */
+#define SNAME_BUFFER_SIZE 256
+static char sname_buffer[SNAME_BUFFER_SIZE];
 static char *sname = NULL;
 
 static void _weprintf(const char *pre, const SourcePos *pos, const char *fmt,
@@ -245,7 +252,9 @@ void setsrcname(char *s)
 		c = s;
 	else
 		c++;
-	sname = estrdup(c);
+	strncpy(sname_buffer, c, SNAME_BUFFER_SIZE - 1);
+	sname_buffer[SNAME_BUFFER_SIZE - 1] = '\0';
+	sname = sname_buffer;
 }
 
 #ifndef __APPLE__
@@ -269,5 +278,5 @@ void freeprogname(void)
 
 void freesrcname(void)
 {
-	free(sname);
+	sname = NULL;
 }
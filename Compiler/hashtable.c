@@ -8,11 +8,17 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "arena.h"
 #include "hashtable.h"
+#include "profile.h"
 
 #define INITIAL_DELTA_INDEX 4
 #define PRINT_BUFFER_SIZE 1024
 
+#define OA_INITIAL_SIZE 16	  /* must be a power of two                  */
+#define OA_MIGRATE_STEP 8	  /* old slots examined per insert           */
+#define OA_TOMBSTONE 0xffffu  /* distance marker for migrated-away slots */
+
 /** an entry in the hash table */
 typedef struct htentry HTentry;
 struct htentry {
@@ -21,6 +27,16 @@ struct htentry {
 	HTentry *next_ptr; /*<< the next entry in the bucket */
 };
 
+/** a slot in the flat open-addressing table; a probe distance of zero marks
+ *  an empty slot, and OA_TOMBSTONE marks a slot whose entry has already been
+ *  migrated to the replacement table
+ */
+typedef struct {
+	void		  *key;	  /*<< the key                        */
+	void		  *value; /*<< the value                      */
+	unsigned short dist;  /*<< the probe distance, plus one   */
+} OAslot;
+
 /** a hash table container */
 struct hashtab {
 	/** a pointer to the underlying table                              */
@@ -37,6 +53,20 @@ struct hashtab {
 	unsigned int (*hash)(void *, unsigned int);
 	/** a pointer to the comparison function                           */
 	int (*cmp)(void *, void *);
+	/** the table implementation                                       */
+	HTKind kind;
+	/** the flat slot array (open addressing only)                     */
+	OAslot *slots;
+	/** the number of tombstones in the flat slot array                */
+	unsigned int num_deleted;
+	/** the table still being drained during an incremental rehash     */
+	OAslot *old_slots;
+	/** the size of the draining table                                 */
+	unsigned int old_size;
+	/** the number of entries still to be migrated                     */
+	unsigned int old_left;
+	/** the next slot of the draining table to examine                 */
+	unsigned int migrate_pos;
 };
 
 /* --- function prototypes -------------------------------------------------- */
@@ -47,6 +77,12 @@ static int getsize(HashTab *ht);
 /*static HTentry **talloc(int tsize);*/
 static void rehash(HashTab *ht);
 
+static void	 oa_put(HashTab *ht, OAslot *slots, unsigned int size, void *key,
+	 void *value);
+static void *oa_find(HashTab *ht, OAslot *slots, unsigned int size, void *key);
+static void	 oa_migrate(HashTab *ht);
+static void	 oa_start_rehash(HashTab *ht);
+
 
 
 /**
@@ -73,6 +109,25 @@ HashTab *ht_init(
 	float loadfactor,
 	unsigned int (*hash)(void *, unsigned int),
 	int (*cmp)(void *, void *))
+{
+	return ht_init_kind(HT_CHAINED, loadfactor, hash, cmp);
+}
+
+
+/**
+ * @brief Initializes a hash table of the specified kind.
+ *
+ * @param kind The table implementation to use.
+ * @param loadfactor The maximum load factor before rehashing.
+ * @param hash A pointer to the hash function.
+ * @param cmp A pointer to the comparison function.
+ * @return A pointer to the initialized hash table or NULL if initialization fails.
+ */
+HashTab *ht_init_kind(
+	HTKind kind,
+	float loadfactor,
+	unsigned int (*hash)(void *, unsigned int),
+	int (*cmp)(void *, void *))
 {
 	HashTab		*ht;
 	unsigned int i;
@@ -83,6 +138,31 @@ HashTab *ht_init(
 		return NULL;
 	}
 
+	ht->kind		   = kind;
+	ht->max_loadfactor = loadfactor;
+	ht->hash		   = hash;
+	ht->cmp			   = cmp;
+	ht->num_entries	   = 0;
+	ht->num_deleted	   = 0;
+	ht->table		   = NULL;
+	ht->slots		   = NULL;
+	ht->old_slots	   = NULL;
+	ht->old_size	   = 0;
+	ht->old_left	   = 0;
+	ht->migrate_pos	   = 0;
+
+	if (kind == HT_OPEN_ADDRESSING)
+	{
+		ht->size  = OA_INITIAL_SIZE;
+		ht->slots = calloc(ht->size, sizeof(OAslot));
+		if (ht->slots == NULL)
+		{
+			free(ht);
+			return NULL;
+		}
+		return ht;
+	}
+
 	ht->size = (1 << INITIAL_DELTA_INDEX) - delta[INITIAL_DELTA_INDEX];
 
 	ht->table = malloc(sizeof(HTentry *) * ht->size);
@@ -93,12 +173,6 @@ HashTab *ht_init(
 		return NULL;
 	}
 	ht->idx			   = INITIAL_DELTA_INDEX;
-	ht->max_loadfactor = loadfactor;
-
-	ht->hash = hash;
-	ht->cmp	 = cmp;
-
-	ht->num_entries = 0;
 
 	for (i = 0; i < ht->size; i++)
 	{
@@ -128,6 +202,27 @@ int ht_insert(HashTab *ht, void *key, void *value)
 		return HASH_TABLE_KEY_VALUE_PAIR_EXISTS;
 	}
 
+	if (ht->kind == HT_OPEN_ADDRESSING)
+	{
+		/* tombstones count towards the load: they lengthen probe sequences
+		 * just like live entries, and a remove-heavy workload would
+		 * otherwise fill the array with them without ever triggering the
+		 * rehash that discards them */
+		if (ht->old_slots != NULL)
+		{
+			oa_migrate(ht);
+		} else if (ht->max_loadfactor
+			< (float)(ht->num_entries + ht->num_deleted + 1) / ht->size)
+		{
+			oa_start_rehash(ht);
+		}
+
+		oa_put(ht, ht->slots, ht->size, key, value);
+		ht->num_entries++;
+
+		return 0;
+	}
+
 	ht->num_entries++;
 	if (ht->max_loadfactor < (float)ht->num_entries / ht->size
 		&& ht->idx < MAX_IDX)
@@ -138,11 +233,7 @@ int ht_insert(HashTab *ht, void *key, void *value)
 
 	k = ht->hash(key, ht->size);
 
-	p = malloc(sizeof(HTentry));
-	if (!p)
-	{
-		return 1;
-	}
+	p = arena_alloc(sizeof(HTentry));
 
 	p->key	 = key;
 	p->value = value;
@@ -171,11 +262,109 @@ void *ht_search(HashTab *ht, void *key)
 		return NULL;
 	}
 
+	prof_ht_searches++;
+
+	if (ht->kind == HT_OPEN_ADDRESSING)
+	{
+		void *value;
+
+		if ((value = oa_find(ht, ht->slots, ht->size, key)) != NULL)
+		{
+			return value;
+		}
+		if (ht->old_slots != NULL)
+		{
+			return oa_find(ht, ht->old_slots, ht->old_size, key);
+		}
+		return NULL;
+	}
+
 	k = ht->hash(key, ht->size);
 	for (p = ht->table[k]; p; p = p->next_ptr)
+	{
+		prof_ht_probes++;
+		if (ht->cmp(key, p->key) == 0)
+		{
+			return p->value;
+		}
+	}
+
+	return NULL;
+}
+
+
+/**
+ * @brief Removes the entry for a key from the hash table.
+ *
+ * @param ht A pointer to the hash table.
+ * @param key The key identifying the entry to remove.
+ * @return A pointer to the value that was associated with the key, or NULL if
+ * the key is not present.
+ */
+void *ht_remove(HashTab *ht, void *key)
+{
+	int		 k;
+	HTentry *p, **pp;
+	void	*value;
+
+	if (!(ht && key))
+	{
+		return NULL;
+	}
+
+	if (ht->kind == HT_OPEN_ADDRESSING)
+	{
+		OAslot		*tables[2];
+		unsigned int sizes[2], t, j;
+
+		tables[0] = ht->slots;
+		sizes[0]  = ht->size;
+		tables[1] = ht->old_slots;
+		sizes[1]  = ht->old_size;
+
+		/* removal leaves a tombstone so that probe sequences running past
+		 * the slot stay intact; tombstones are discarded by the next rehash
+		 */
+		for (t = 0; t < 2; t++)
+		{
+			if (tables[t] == NULL)
+			{
+				continue;
+			}
+			j = ht->hash(key, sizes[t]);
+			while (tables[t][j].dist != 0)
+			{
+				if (tables[t][j].dist != OA_TOMBSTONE
+					&& ht->cmp(key, tables[t][j].key) == 0)
+				{
+					value			  = tables[t][j].value;
+					tables[t][j].dist = OA_TOMBSTONE;
+					ht->num_entries--;
+					if (t == 1)
+					{
+						/* tombstones in the draining table die with it */
+						ht->old_left--;
+					} else
+					{
+						ht->num_deleted++;
+					}
+					return value;
+				}
+				j = (j + 1) % sizes[t];
+			}
+		}
+
+		return NULL;
+	}
+
+	k = ht->hash(key, ht->size);
+	for (pp = &ht->table[k]; (p = *pp) != NULL; pp = &p->next_ptr)
 	{
 		if (ht->cmp(key, p->key) == 0)
 		{
+			*pp = p->next_ptr;
+			ht->num_entries--;
+			/* the entry itself is arena-allocated and is not freed here */
 			return p->value;
 		}
 	}
@@ -202,6 +391,42 @@ int ht_free(HashTab *ht, void (*freekey)(void *k), void (*freeval)(void *v))
 		return EXIT_FAILURE;
 	}
 
+	if (ht->kind == HT_OPEN_ADDRESSING)
+	{
+		OAslot *tables[2];
+		unsigned int sizes[2], t, j;
+
+		tables[0] = ht->slots;
+		sizes[0]  = ht->size;
+		tables[1] = ht->old_slots;
+		sizes[1]  = ht->old_size;
+
+		for (t = 0; t < 2; t++)
+		{
+			if (tables[t] == NULL)
+			{
+				continue;
+			}
+			for (j = 0; j < sizes[t]; j++)
+			{
+				if (tables[t][j].dist != 0
+					&& tables[t][j].dist != OA_TOMBSTONE)
+				{
+					freekey(tables[t][j].key);
+					freeval(tables[t][j].value);
+				}
+			}
+			free(tables[t]);
+		}
+
+		free(ht);
+		return EXIT_SUCCESS;
+	}
+
+	/* the entries themselves are arena-allocated, and are reclaimed wholesale
+	 * when the arena is released; only the keys and values are handed back to
+	 * the caller for release
+	 */
 	for (i = 0; i < ht->size; i++)
 	{
 		p = ht->table[i];
@@ -219,7 +444,6 @@ int ht_free(HashTab *ht, void (*freekey)(void *k), void (*freeval)(void *v))
 				freeval(p->value);
 			}
 
-			free(p);
 			p = q;
 		}
 	}
@@ -256,6 +480,22 @@ void ht_print(HashTab *ht, void (*keyval2str)(void *k, void *v, char *b))
 	 * write your own keyval2str function if you want to use it.
 	 */
 
+	if (ht && keyval2str && ht->kind == HT_OPEN_ADDRESSING)
+	{
+		for (i = 0; i < ht->size; i++)
+		{
+			printf("slot[%2i]", i);
+			if (ht->slots[i].dist != 0 && ht->slots[i].dist != OA_TOMBSTONE)
+			{
+				keyval2str(ht->slots[i].key, ht->slots[i].value, buffer);
+				printf(" --> %s (dist %u)", buffer,
+					(unsigned int)ht->slots[i].dist - 1);
+			}
+			printf("\n");
+		}
+		return;
+	}
+
 	if (ht && keyval2str)
 	{
 		for (i = 0; i < ht->size; i++)
@@ -302,6 +542,143 @@ static HTentry **talloc(int tsize)
 
 
 
+/**
+ * @brief Places an entry into a flat slot array using robin-hood probing.
+ *
+ * An entry that has probed further than the incumbent of a slot displaces
+ * that incumbent, which then continues probing in its place; this keeps the
+ * variance of probe lengths low.  The caller must guarantee free space.
+ *
+ * @param ht A pointer to the hash table.
+ * @param slots The slot array to place the entry in.
+ * @param size The size of the slot array.
+ * @param key The key to place.
+ * @param value The value associated with the key.
+ */
+static void oa_put(HashTab *ht, OAslot *slots, unsigned int size, void *key,
+	void *value)
+{
+	unsigned int   k;
+	unsigned short dist;
+	OAslot		   tmp;
+
+	k	 = ht->hash(key, size);
+	dist = 1;
+
+	while (slots[k].dist != 0 && slots[k].dist != OA_TOMBSTONE)
+	{
+		if (slots[k].dist < dist)
+		{
+			tmp				= slots[k];
+			slots[k].key	= key;
+			slots[k].value	= value;
+			slots[k].dist	= dist;
+			key				= tmp.key;
+			value			= tmp.value;
+			dist			= tmp.dist;
+		}
+		k = (k + 1) % size;
+		dist++;
+	}
+
+	slots[k].key   = key;
+	slots[k].value = value;
+	slots[k].dist  = dist;
+}
+
+/**
+ * @brief Searches a flat slot array for a key.
+ *
+ * @param ht A pointer to the hash table.
+ * @param slots The slot array to search.
+ * @param size The size of the slot array.
+ * @param key The key to search for.
+ * @return A pointer to the value, or NULL if the key is not present.
+ */
+static void *oa_find(HashTab *ht, OAslot *slots, unsigned int size, void *key)
+{
+	unsigned int k;
+
+	k = ht->hash(key, size);
+
+	while (slots[k].dist != 0)
+	{
+		prof_ht_probes++;
+		if (slots[k].dist != OA_TOMBSTONE && ht->cmp(key, slots[k].key) == 0)
+		{
+			return slots[k].value;
+		}
+		k = (k + 1) % size;
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief Starts an incremental rehash of an open-addressing table.
+ *
+ * The current slot array is retired and a new array of twice the size takes
+ * its place; the retired array is drained a few slots at a time by
+ * oa_migrate, so no single insertion pays the full rehash cost.
+ *
+ * @param ht A pointer to the hash table.
+ */
+static void oa_start_rehash(HashTab *ht)
+{
+	OAslot *new_slots;
+
+	new_slots = calloc(ht->size * 2, sizeof(OAslot));
+	if (new_slots == NULL)
+	{
+		/* keep the old table; the next insert will try again */
+		return;
+	}
+
+	prof_ht_rehashes++;
+
+	ht->old_slots	= ht->slots;
+	ht->old_size	= ht->size;
+	ht->old_left	= ht->num_entries;
+	ht->migrate_pos = 0;
+
+	ht->slots		= new_slots;
+	ht->size		= ht->size * 2;
+	ht->num_deleted = 0;
+}
+
+/**
+ * @brief Migrates a bounded number of entries from the draining table.
+ *
+ * @param ht A pointer to the hash table.
+ */
+static void oa_migrate(HashTab *ht)
+{
+	unsigned int moved;
+	OAslot		*slot;
+
+	moved = 0;
+	while (moved < OA_MIGRATE_STEP && ht->old_left > 0)
+	{
+		slot = &ht->old_slots[ht->migrate_pos];
+		if (slot->dist != 0 && slot->dist != OA_TOMBSTONE)
+		{
+			oa_put(ht, ht->slots, ht->size, slot->key, slot->value);
+			slot->dist = OA_TOMBSTONE;
+			ht->old_left--;
+			moved++;
+		}
+		ht->migrate_pos++;
+	}
+
+	if (ht->old_left == 0)
+	{
+		free(ht->old_slots);
+		ht->old_slots	= NULL;
+		ht->old_size	= 0;
+		ht->migrate_pos = 0;
+	}
+}
+
 /**
  * @brief Rehashes the hash table to accommodate more entries.
  *
@@ -314,6 +691,8 @@ static void rehash(HashTab *ht)
 	HTentry		*p, *next;
 	HTentry	   **new_table;
 
+	prof_ht_rehashes++;
+
 	size = getsize(ht);
 
 	new_table = (HTentry **)malloc(sizeof(HTentry *) * size);
@@ -22,6 +22,15 @@
 /** the container structure for a hash table */
 typedef struct hashtab HashTab;
 
+/** the available table implementations */
+typedef enum {
+	/** separate chaining: entries are linked through bucket lists         */
+	HT_CHAINED,
+	/** open addressing: robin-hood probing in a flat slot array, with the
+	 *  rehash performed incrementally over subsequent insertions          */
+	HT_OPEN_ADDRESSING
+} HTKind;
+
 /* --- function prototypes -------------------------------------------------- */
 
 /**
@@ -47,6 +56,30 @@ HashTab *ht_init(float loadfactor,
 				 unsigned int (*hash)(void *key, unsigned int size),
 				 int (*cmp)(void *val1, void *val2));
 
+/**
+ * Initialise a hash table of the specified kind.  This function behaves like
+ * <code>ht_init</code>, but allows the caller to select the underlying table
+ * implementation; <code>ht_init</code> itself is equivalent to passing
+ * <code>HT_CHAINED</code>.  All other functions in this unit work on either
+ * kind of table.
+ *
+ * @param[in]  kind
+ *     the table implementation to use
+ * @param[in]  loadfactor
+ *     the maximum load factor, which, when reached, triggers a resize of the
+ *     underlying table
+ * @param[in]  hash
+ *     a pointer to a hash function over the domain of the keys
+ * @param[in]  cmp
+ *     a pointer to a function that compares two keys
+ * @return
+ *     a pointer to the hash table container structure, or <code>NULL</code> if
+ *     initialisation failed
+ */
+HashTab *ht_init_kind(HTKind kind, float loadfactor,
+					  unsigned int (*hash)(void *key, unsigned int size),
+					  int (*cmp)(void *val1, void *val2));
+
 /**
  * Associate the specified key with the specified value in the specified hash
  * table.  This function fails if any argument is <code>NULL</code>, or if
@@ -79,6 +112,23 @@ int ht_insert(HashTab *ht, void *key, void *value);
  */
 void *ht_search(HashTab *ht, void *key);
 
+/**
+ * Remove the entry associated with the specified key from the specified hash
+ * table.  This function fails if any argument is <code>NULL</code>.  The key
+ * and value themselves are not released; the value is returned so that the
+ * caller can dispose of both as appropriate.
+ *
+ * @param[in]  ht
+ *     a pointer to the hash table from which to remove the entry
+ * @param[in]  key
+ *     the key identifying the entry to remove
+ * @return
+ *     a pointer to the value that was associated with the key, or
+ *     <code>NULL</code> if the key was not found or any argument value is
+ *     <code>NULL</code>
+ */
+void *ht_remove(HashTab *ht, void *key);
+
 /**
  * Free the space associated with the specified hash table.  This function fails
  * if any argument is <code>NULL</code>.
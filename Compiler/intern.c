@@ -0,0 +1,133 @@
+/**
+ * @file    intern.c
+ * @brief   An identifier interning pool for AMPL-2023.
+ * @date    2023-08-10
+ */
+
+#include "intern.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "error.h"
+
+#define INITIAL_POOL_SIZE 256 /* must be a power of two  */
+#define MAX_POOL_LOAD_NUM 3	  /* resize above 3/4 load   */
+#define MAX_POOL_LOAD_DEN 4
+
+/* --- global static variables ---------------------------------------------- */
+
+static const char **pool;		 /* open-addressing table of canonical strings */
+static unsigned int pool_size;	 /* the current table size, a power of two     */
+static unsigned int pool_count; /* the number of interned strings              */
+
+/* --- function prototypes -------------------------------------------------- */
+
+static unsigned int fnv1a_hash(const char *s);
+static void			grow_pool(void);
+
+/* --- interning pool interface ---------------------------------------------- */
+
+void init_intern_pool(void)
+{
+	pool	   = calloc(INITIAL_POOL_SIZE, sizeof(const char *));
+	pool_size  = INITIAL_POOL_SIZE;
+	pool_count = 0;
+
+	if (pool == NULL)
+	{
+		eprintf("Interning pool could not be initialised");
+	}
+}
+
+const char *intern(const char *s)
+{
+	unsigned int k;
+
+	if (pool_count * MAX_POOL_LOAD_DEN >= pool_size * MAX_POOL_LOAD_NUM)
+	{
+		grow_pool();
+	}
+
+	k = fnv1a_hash(s) & (pool_size - 1);
+	while (pool[k] != NULL)
+	{
+		if (strcmp(pool[k], s) == 0)
+		{
+			return pool[k];
+		}
+		k = (k + 1) & (pool_size - 1);
+	}
+
+	pool[k] = arena_strdup(s);
+	pool_count++;
+
+	return pool[k];
+}
+
+void release_intern_pool(void)
+{
+	free(pool);
+	pool	   = NULL;
+	pool_size  = 0;
+	pool_count = 0;
+}
+
+/* --- utility functions ---------------------------------------------------- */
+
+/**
+ * Computes the 32-bit FNV-1a hash of a string.
+ *
+ * @param[in] s the string to hash
+ * @return the hash value
+ */
+static unsigned int fnv1a_hash(const char *s)
+{
+	unsigned int hash = 2166136261u;
+
+	while (*s)
+	{
+		hash ^= (unsigned char)*s++;
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+/**
+ * Doubles the pool table and reinserts the interned strings.  The strings
+ * keep their identity; only the slots move.
+ */
+static void grow_pool(void)
+{
+	const char **old_pool;
+	unsigned int old_size, i, k;
+
+	old_pool  = pool;
+	old_size  = pool_size;
+	pool_size = pool_size * 2;
+	pool	  = calloc(pool_size, sizeof(const char *));
+
+	if (pool == NULL)
+	{
+		eprintf("Interning pool could not be resized");
+	}
+
+	for (i = 0; i < old_size; i++)
+	{
+		if (old_pool[i] == NULL)
+		{
+			continue;
+		}
+
+		k = fnv1a_hash(old_pool[i]) & (pool_size - 1);
+		while (pool[k] != NULL)
+		{
+			k = (k + 1) & (pool_size - 1);
+		}
+		pool[k] = old_pool[i];
+	}
+
+	free(old_pool);
+}
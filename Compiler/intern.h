@@ -0,0 +1,39 @@
+/**
+ * @file    intern.h
+ * @brief   Definitions for the identifier interning pool of AMPL-2023.
+ * @date    2023-08-10
+ *
+ * Every distinct identifier is stored exactly once, so two interned strings
+ * are equal if and only if their pointers are equal.  This lets the symbol
+ * table hash and compare identifiers by pointer instead of by content, and
+ * removes the per-token string duplication in the parser.  The characters
+ * themselves live in the compiler arena.
+ */
+
+#ifndef INTERN_H
+#define INTERN_H
+
+/**
+ * Initialise the interning pool.  This must be called after
+ * <code>init_arena</code>, and before the first call to <code>intern</code>.
+ */
+void init_intern_pool(void);
+
+/**
+ * Intern the specified string.
+ *
+ * @param[in]  s
+ *     the string to intern
+ * @return
+ *     the canonical copy of the string; the same pointer is returned for
+ *     every string with the same content
+ */
+const char *intern(const char *s);
+
+/**
+ * Release the resources held by the interning pool.  The interned strings
+ * themselves are arena-allocated and are reclaimed with the arena.
+ */
+void release_intern_pool(void);
+
+#endif /* INTERN_H */
@@ -0,0 +1,82 @@
+/**
+ * @file    profile.c
+ * @brief   Compile-time profiling counters and phase timers for AMPL-2023.
+ * @date    2023-08-13
+ */
+
+#include "profile.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/* --- global variables ------------------------------------------------------ */
+
+unsigned long prof_tokens;
+unsigned long prof_ht_searches;
+unsigned long prof_ht_probes;
+unsigned long prof_ht_rehashes;
+unsigned long prof_instrs;
+unsigned long prof_code_growths;
+
+/* --- global static variables ----------------------------------------------- */
+
+static long long phase_ns[PROF_NPHASES]; /* accumulated time per phase   */
+static long long phase_t0[PROF_NPHASES]; /* start time of the open phase */
+
+/* --- function prototypes --------------------------------------------------- */
+
+static long long now_ns(void);
+
+/* --- profiling interface --------------------------------------------------- */
+
+void init_profile(void)
+{
+	prof_tokens		  = 0;
+	prof_ht_searches  = 0;
+	prof_ht_probes	  = 0;
+	prof_ht_rehashes  = 0;
+	prof_instrs		  = 0;
+	prof_code_growths = 0;
+
+	memset(phase_ns, 0, sizeof(phase_ns));
+}
+
+void profile_start(ProfPhase phase) { phase_t0[phase] = now_ns(); }
+
+void profile_end(ProfPhase phase)
+{
+	phase_ns[phase] += now_ns() - phase_t0[phase];
+}
+
+void profile_report(const char *src_name)
+{
+	double parse_s, emit_s;
+
+	parse_s = phase_ns[PROF_PARSE] / 1e9;
+	emit_s	= phase_ns[PROF_EMIT] / 1e9;
+
+	fprintf(stderr,
+		"profile src=%s parse_ns=%lld emit_ns=%lld tokens=%lu"
+		" tokens_per_sec=%.0f ht_searches=%lu ht_probes=%lu ht_rehashes=%lu"
+		" instrs=%lu instrs_per_sec=%.0f code_growths=%lu\n",
+		src_name, phase_ns[PROF_PARSE], phase_ns[PROF_EMIT], prof_tokens,
+		(parse_s > 0.0 ? prof_tokens / parse_s : 0.0), prof_ht_searches,
+		prof_ht_probes, prof_ht_rehashes, prof_instrs,
+		(parse_s + emit_s > 0.0 ? prof_instrs / (parse_s + emit_s) : 0.0),
+		prof_code_growths);
+}
+
+/* --- utility functions ----------------------------------------------------- */
+
+/**
+ * Returns a monotonic timestamp in nanoseconds.
+ */
+static long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
@@ -0,0 +1,65 @@
+/**
+ * @file    profile.h
+ * @brief   Compile-time profiling counters and phase timers for AMPL-2023.
+ * @date    2023-08-13
+ *
+ * The hot paths in the scanner, hash table, and code generator bump the
+ * counters below unconditionally -- a single increment is cheaper than a
+ * branch to guard it -- and the driver brackets its phases with the timer
+ * calls.  Nothing is reported unless the driver asks for the summary, so
+ * normal compilations stay silent.
+ */
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+/* --- the profiled phases --------------------------------------------------- */
+
+typedef enum {
+	PROF_PARSE,	 /**< scanning and parsing, up to the end of parse_program  */
+	PROF_EMIT,	 /**< object code emission (classfile or Jasmin + assemble) */
+	PROF_NPHASES
+} ProfPhase;
+
+/* --- hot-path counters ----------------------------------------------------- */
+
+extern unsigned long prof_tokens;		/**< tokens returned by get_token    */
+extern unsigned long prof_ht_searches;	/**< calls to ht_search              */
+extern unsigned long prof_ht_probes;	/**< slots or chain nodes inspected  */
+extern unsigned long prof_ht_rehashes;	/**< table resizes started           */
+extern unsigned long prof_instrs;		/**< instructions emitted            */
+extern unsigned long prof_code_growths; /**< code array reallocations        */
+
+/* --- function prototypes --------------------------------------------------- */
+
+/**
+ * Reset all counters and timers for the next compilation.
+ */
+void init_profile(void);
+
+/**
+ * Start timing the specified phase.
+ *
+ * @param[in]  phase
+ *     the phase being entered
+ */
+void profile_start(ProfPhase phase);
+
+/**
+ * Stop timing the specified phase, accumulating the elapsed time.
+ *
+ * @param[in]  phase
+ *     the phase being left
+ */
+void profile_end(ProfPhase phase);
+
+/**
+ * Write the machine-readable summary for the compilation of the specified
+ * source file to standard error, as a single line of key=value pairs.
+ *
+ * @param[in]  src_name
+ *     the name of the source file the summary belongs to
+ */
+void profile_report(const char *src_name);
+
+#endif /* PROFILE_H */
@@ -8,17 +8,27 @@
 #include "scanner.h"
 
 #include <ctype.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 #include <limits.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "boolean.h"
 #include "error.h"
+#include "profile.h"
 #include "token.h"
 
 /* --- global static variables ---------------------------------------------- */
 
-static FILE *src_file;		/* the source file pointer             */
+static char	  *src_buf;		/* the source text, held in memory     */
+static size_t  src_len;		/* the number of bytes in the buffer   */
+static size_t  src_next;	/* index of the next unread character  */
+static Boolean src_mapped;	/* whether the buffer is memory-mapped */
 static int	 ch;			/* the next source character           */
 static int	 column_number; /* the current column number           */
 static struct {
@@ -41,25 +51,62 @@ static struct {
 
 #define NUM_RESERVED_WORDS (sizeof(reserved) / sizeof(reserved[0]))
 #define MAX_INIT_STR_LEN (1024)
+#define READ_BLOCK_SIZE (64 * 1024)
+
+#define MIN_RESERVED_LEN (2)
+#define MAX_RESERVED_LEN (7)
+
+/**
+ * The keyword dispatch table, indexed by lexeme length, first letter, and last
+ * letter.  This triple is unique over the reserved words, so classifying an
+ * identifier takes one table lookup and at most one memcmp.  The table is
+ * derived from <code>reserved</code> at start-up, which keeps the token
+ * definitions the single source of truth.
+ */
+static short kw_dispatch[MAX_RESERVED_LEN + 1][26][26];
 
 /* --- function prototypes -------------------------------------------------- */
 
-static void next_char(void);
-static void process_number(Token *token);
-static void process_string(Token *token);
-static void process_word(Token *token);
-static void skip_comment(void);
+static void	  advance_to(size_t target);
+static void	  init_keyword_dispatch(void);
+static void	  load_source(FILE *in_file);
+static void	  next_char(void);
+static void	  process_number(Token *token);
+static void	  process_string(Token *token);
+static void	  process_word(Token *token);
+static void	  skip_comment(void);
+static size_t span_comment(size_t from);
+static size_t span_space(size_t from);
+static size_t span_string(size_t from);
+static size_t span_word(size_t from);
 
 /* --- scanner interface ---------------------------------------------------- */
 
 void init_scanner(FILE *in_file)
 {
-	src_file	  = in_file;
+	init_keyword_dispatch();
+	load_source(in_file);
 	position.line = 1;
 	position.col = column_number = 0;
 	next_char();
 }
 
+void release_scanner(void)
+{
+	if (src_buf != NULL)
+	{
+		if (src_mapped)
+		{
+			munmap(src_buf, src_len);
+		} else
+		{
+			free(src_buf);
+		}
+		src_buf = NULL;
+	}
+	src_len = src_next = 0;
+}
+
 /**
  * @brief Reads and processes the next token from the file.
  *
@@ -74,11 +121,13 @@ void init_scanner(FILE *in_file)
 
 void get_token(Token *token)
 {
+	prof_tokens++;
+
 	while (ch == '{' || isspace(ch) || ch == '\n')
 	{
-		while (isspace(ch))
+		if (isspace(ch))
 		{
-			next_char();
+			advance_to(span_space(src_next));
 		}
 
 		if (ch == '{')
@@ -294,7 +343,156 @@ void get_token(Token *token)
 /* --- utility functions ---------------------------------------------------- */
 
 /**
- * Gets the next character from the file and updates position.
+ * Consumes the source buffer up to and including the specified index, making
+ * that character the current one.  This is the bulk counterpart of
+ * <code>next_char</code>: the line and column counters are brought up to date
+ * by scanning the skipped bytes for newlines, so error positions are the same
+ * as if the characters had been consumed one by one.  A target at or beyond
+ * the end of the buffer consumes the remaining characters and leaves the
+ * scanner at end-of-file.
+ *
+ * @param[in] target the index of the character to make current
+ */
+static void advance_to(size_t target)
+{
+	size_t		start, limit, nlines;
+	const char *p, *nl, *last_nl;
+
+	start = src_next - 1;
+	limit = (target < src_len ? target : src_len - 1);
+
+	nlines	= 0;
+	last_nl = NULL;
+	p		= src_buf + start;
+	while ((size_t)(p - src_buf) < limit
+		&& (nl = memchr(p, '\n', limit - (p - src_buf))) != NULL)
+	{
+		nlines++;
+		last_nl = nl;
+		p		= nl + 1;
+	}
+	position.line += nlines;
+
+	if (target < src_len)
+	{
+		if (last_nl != NULL)
+		{
+			column_number = target - (last_nl - src_buf);
+		} else
+		{
+			column_number += target - start;
+		}
+		src_next = target + 1;
+		ch		 = (unsigned char)src_buf[target];
+	} else
+	{
+		if (last_nl != NULL)
+		{
+			column_number = src_len - (last_nl - src_buf);
+		} else
+		{
+			column_number += src_len - start;
+		}
+		src_next = src_len;
+		ch		 = EOF;
+	}
+}
+
+/**
+ * Builds the keyword dispatch table from the reserved-word table.
+ *
+ * This function runs exactly once; subsequent calls return immediately.
+ *
+ * @return void
+ */
+static void init_keyword_dispatch(void)
+{
+	static Boolean ready = FALSE;
+	size_t		   i, len, first, last;
+
+	if (ready)
+	{
+		return;
+	}
+
+	memset(kw_dispatch, -1, sizeof(kw_dispatch));
+
+	for (i = 0; i < NUM_RESERVED_WORDS; i++)
+	{
+		len	  = strlen(reserved[i].word);
+		first = reserved[i].word[0] - 'a';
+		last  = reserved[i].word[len - 1] - 'a';
+
+		if (len < MIN_RESERVED_LEN || len > MAX_RESERVED_LEN
+			|| kw_dispatch[len][first][last] != -1)
+		{
+			eprintf("keyword dispatch table cannot represent '%s'",
+				reserved[i].word);
+		}
+
+		kw_dispatch[len][first][last] = i;
+	}
+
+	ready = TRUE;
+}
+
+/**
+ * Reads the whole source file into memory.
+ *
+ * Regular files are memory-mapped so that the scanner can walk the raw bytes
+ * without any per-character library calls.  If the input cannot be mapped --
+ * for example, when the source is piped in -- the file is read into a
+ * heap-allocated buffer in large blocks instead.
+ *
+ * @param[in] in_file the (already open) source file
+ */
+static void load_source(FILE *in_file)
+{
+	struct stat st;
+	size_t		cap, n;
+	int			fd;
+
+	src_buf	   = NULL;
+	src_len	   = 0;
+	src_next   = 0;
+	src_mapped = FALSE;
+
+	fd = fileno(in_file);
+
+	if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+	{
+		src_buf = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (src_buf != MAP_FAILED)
+		{
+			src_len	   = st.st_size;
+			src_mapped = TRUE;
+			return;
+		}
+		src_buf = NULL;
+	}
+
+	/* fall back to block reads for pipes and unmappable files */
+	cap		= READ_BLOCK_SIZE;
+	src_buf = emalloc(cap);
+
+	while ((n = fread(src_buf + src_len, 1, cap - src_len, in_file)) > 0)
+	{
+		src_len += n;
+		if (src_len == cap)
+		{
+			cap *= 2;
+			src_buf = erealloc(src_buf, cap);
+		}
+	}
+
+	if (ferror(in_file))
+	{
+		eprintf("could not read source file:");
+	}
+}
+
+/**
+ * Gets the next character from the source buffer and updates position.
  *
  * @return void
  */
@@ -304,9 +502,12 @@ void next_char(void)
 	static char last_read = '\0';
 
 	last_read = ch;
-	ch		  = fgetc(src_file);
-	if (ch == EOF)
+	if (src_next < src_len)
+	{
+		ch = (unsigned char)src_buf[src_next++];
+	} else
 	{
+		ch = EOF;
 		column_number++;
 		return;
 	}
@@ -334,24 +535,29 @@ void next_char(void)
 
 void process_number(Token *token)
 {
-	int number;
-	int nextnum;
-	number	= ch - '0';
-	nextnum = 0;
+	size_t start, end, j;
+	int	   number;
+	int	   nextnum;
 
-	next_char();
+	/*
+	 * Finds the end of the span first, so that the digits can be read
+	 * straight out of the buffer; the value loop stops at the first byte in
+	 * the span that is not a digit, which then becomes the current character.
+	 */
+	start  = src_next - 1;
+	end	   = span_word(src_next);
+	number = 0;
 
-	while (isdigit(ch))
+	for (j = start; j < end && isdigit((unsigned char)src_buf[j]); j++)
 	{
-		nextnum = ch - '0';
+		nextnum = src_buf[j] - '0';
 		if (number > (INT_MAX - nextnum) / 10)
 		{
 			leprintf("number too large");
 		}
 		number = 10 * number + nextnum;
-
-		next_char();
 	}
+	advance_to(j);
 
 	token->type	 = TOK_NUM;
 	token->value = number;
@@ -386,26 +592,21 @@ void process_string(Token *token)
 		{
 			leprintf("string not closed");
 		}
-		if (i >= nstring)
-		{
-			nstring *= 2;
-			my_string
-				= (char *)realloc(my_string, (nstring + 1) * sizeof(char));
 
-			if (my_string == NULL)
+		if (ch == '\\')
+		{
+			if (i + 2 > nstring)
 			{
-				leprintf("Memory reallocation failed.\n");
+				nstring *= 2;
+				my_string
+					= (char *)realloc(my_string, (nstring + 1) * sizeof(char));
+
+				if (my_string == NULL)
+				{
+					leprintf("Memory reallocation failed.\n");
+				}
 			}
-		}
 
-		if (!(isprint(ch)))
-		{
-			position.col = column_number;
-			leprintf("non-printable character (ASCII #%d) in string", ch);
-		}
-
-		if (ch == '\\')
-		{
 			my_string[i] = ch;
 			i++;
 			next_char();
@@ -419,13 +620,44 @@ void process_string(Token *token)
 				position.col = column_number - 1;
 				leprintf("illegal escape code '\\%c' in string", ch);
 			}
+
+			i++;
+			next_char();
+
+		} else if (!(isprint(ch)))
+		{
+			position.col = column_number;
+			leprintf("non-printable character (ASCII #%d) in string", ch);
+
 		} else
 		{
-			my_string[i] = ch;
-		}
+			/*
+			 * Copies the run of plain characters ending at the next quote,
+			 * backslash, or non-printable character as a single slice of the
+			 * buffer.
+			 */
+			size_t start, end, len;
+
+			start = src_next - 1;
+			end	  = span_string(src_next);
+			len	  = end - start;
+
+			while (i + len > nstring)
+			{
+				nstring *= 2;
+				my_string
+					= (char *)realloc(my_string, (nstring + 1) * sizeof(char));
+
+				if (my_string == NULL)
+				{
+					leprintf("Memory reallocation failed.\n");
+				}
+			}
 
-		i++;
-		next_char();
+			memcpy(my_string + i, src_buf + start, len);
+			i += len;
+			advance_to(end);
+		}
 	}
 	next_char();
 
@@ -440,9 +672,9 @@ void process_string(Token *token)
  * @brief Processes an identifier or keyword, and creates a corresponding token.
  *
  * This function processes characters to form an identifier or keyword token,
- * handling the case where the identifier is too long. It compares the generated
- * lexeme to a list of reserved keywords using binary search to determine if the
- * token should be of a specific keyword type.
+ * handling the case where the identifier is too long. It classifies the
+ * generated lexeme against the reserved keywords through the dispatch table,
+ * so that at most one memcmp is required.
  *
  *
  * @param token A pointer to the Token structure.
@@ -450,47 +682,38 @@ void process_string(Token *token)
  */
 void process_word(Token *token)
 {
-	char lexeme[MAX_ID_LEN + 1];
-	int	 i, cmp, low, mid, high;
-	i = 0;
+	char   lexeme[MAX_ID_LEN + 1];
+	size_t start, end;
+	int	   i, k;
 
-	while (isalpha(ch) || ch == '_' || isdigit(ch))
+	/* take the lexeme as a single slice of the source buffer */
+	start = src_next - 1;
+	end	  = span_word(src_next);
+
+	if (end - start > MAX_ID_LEN)
 	{
-		if (i == MAX_ID_LEN)
-		{
-			leprintf("identifier too long");
-		}
-		lexeme[i] = ch;
-		i++;
-		next_char();
+		leprintf("identifier too long");
 	}
+	i = end - start;
+	memcpy(lexeme, src_buf + start, i);
 	lexeme[i] = '\0';
+	advance_to(end);
 
-	low			= 0;
-	high		= sizeof(reserved) / sizeof(reserved[0]) - 1;
 	token->type = TOK_ID;
 	strcpy(token->lexeme, lexeme);
 
 	/*
-	 * Performs a binary search to match a lexeme with reserved keywords.
+	 * Looks up the lexeme in the keyword dispatch table; the candidate (if
+	 * any) is verified with a single memcmp.
 	 */
-	while (low <= high)
+	if (i >= MIN_RESERVED_LEN && i <= MAX_RESERVED_LEN && islower(lexeme[0])
+		&& islower(lexeme[i - 1]))
 	{
-		mid = low + (high - low) / 2;
-		cmp = strcmp(lexeme, reserved[mid].word);
-
-		if (cmp == 0)
+		k = kw_dispatch[i][lexeme[0] - 'a'][lexeme[i - 1] - 'a'];
+		if (k >= 0 && memcmp(lexeme, reserved[k].word, i) == 0)
 		{
 			strcpy(token->lexeme, "");
-
-			token->type = reserved[mid].type;
-			break;
-		} else if (cmp < 0)
-		{
-			high = mid - 1;
-		} else
-		{
-			low = mid + 1;
+			token->type = reserved[k].type;
 		}
 	}
 }
@@ -520,8 +743,179 @@ void skip_comment(void)
 		if (ch == '{')
 		{
 			skip_comment();
+			next_char();
+		} else
+		{
+			/* skip ahead to the next brace or end-of-file in one stride */
+			advance_to(span_comment(src_next));
+		}
+	}
+}
+
+/**
+ * Finds the end of the run of comment text that starts at the specified
+ * index; that is, the index of the next opening or closing brace, or of the
+ * end of the buffer.
+ *
+ * Like the other span kernels below, this routine classifies the source
+ * sixteen bytes at a stride on targets with SSE2, and falls back to a scalar
+ * loop -- which also handles the tail of the buffer -- elsewhere.
+ *
+ * @param[in] from the index at which to start scanning
+ * @return the index of the first byte not part of the run
+ */
+static size_t span_comment(size_t from)
+{
+#ifdef __SSE2__
+	__m128i bytes, mask;
+	int		bits;
+
+	while (from + 16 <= src_len)
+	{
+		bytes = _mm_loadu_si128((const __m128i *)(src_buf + from));
+		mask  = _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('{')),
+			 _mm_cmpeq_epi8(bytes, _mm_set1_epi8('}')));
+		bits  = _mm_movemask_epi8(mask);
+		if (bits != 0)
+		{
+			return from + __builtin_ctz(bits);
+		}
+		from += 16;
+	}
+#endif /* __SSE2__ */
+
+	while (from < src_len && src_buf[from] != '{' && src_buf[from] != '}')
+	{
+		from++;
+	}
+
+	return from;
+}
+
+/**
+ * Finds the end of the run of whitespace that starts at the specified index.
+ *
+ * @param[in] from the index at which to start scanning
+ * @return the index of the first non-whitespace byte
+ */
+static size_t span_space(size_t from)
+{
+#ifdef __SSE2__
+	__m128i bytes, mask;
+	int		bits;
+
+	while (from + 16 <= src_len)
+	{
+		bytes = _mm_loadu_si128((const __m128i *)(src_buf + from));
+		/* a space proper, or one of the control characters '\t' to '\r' */
+		mask  = _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(' ')),
+			 _mm_and_si128(_mm_cmpgt_epi8(bytes, _mm_set1_epi8('\t' - 1)),
+				 _mm_cmpgt_epi8(_mm_set1_epi8('\r' + 1), bytes)));
+		bits  = ~_mm_movemask_epi8(mask) & 0xffff;
+		if (bits != 0)
+		{
+			return from + __builtin_ctz(bits);
+		}
+		from += 16;
+	}
+#endif /* __SSE2__ */
+
+	while (from < src_len && isspace((unsigned char)src_buf[from]))
+	{
+		from++;
+	}
+
+	return from;
+}
+
+/**
+ * Finds the end of the run of plain string characters that starts at the
+ * specified index; that is, the index of the next quote, backslash, or
+ * non-printable byte.
+ *
+ * @param[in] from the index at which to start scanning
+ * @return the index of the first byte not part of the run
+ */
+static size_t span_string(size_t from)
+{
+#ifdef __SSE2__
+	__m128i bytes, mask;
+	int		bits;
+
+	while (from + 16 <= src_len)
+	{
+		bytes = _mm_loadu_si128((const __m128i *)(src_buf + from));
+		/* printable, i.e., in the range from space to tilde ... */
+		mask  = _mm_and_si128(_mm_cmpgt_epi8(bytes, _mm_set1_epi8(' ' - 1)),
+			 _mm_cmpgt_epi8(_mm_set1_epi8('~' + 1), bytes));
+		/* ... but neither a quote nor a backslash */
+		mask  = _mm_andnot_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('"')),
+			 mask);
+		mask  = _mm_andnot_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('\\')),
+			 mask);
+		bits  = ~_mm_movemask_epi8(mask) & 0xffff;
+		if (bits != 0)
+		{
+			return from + __builtin_ctz(bits);
 		}
+		from += 16;
+	}
+#endif /* __SSE2__ */
 
-		next_char();
+	while (from < src_len && isprint((unsigned char)src_buf[from])
+		&& src_buf[from] != '"' && src_buf[from] != '\\')
+	{
+		from++;
 	}
+
+	return from;
+}
+
+/**
+ * Finds the end of the identifier or number span that starts at the specified
+ * index; that is, the index of the first byte that is not a letter, digit, or
+ * underscore.
+ *
+ * @param[in] from the index at which to start scanning
+ * @return the index of the first byte not part of the span
+ */
+static size_t span_word(size_t from)
+{
+#ifdef __SSE2__
+	__m128i bytes, mask;
+	int		bits;
+
+	while (from + 16 <= src_len)
+	{
+		bytes = _mm_loadu_si128((const __m128i *)(src_buf + from));
+		mask  = _mm_or_si128(
+			 _mm_or_si128(
+				 _mm_and_si128(
+					 _mm_cmpgt_epi8(bytes, _mm_set1_epi8('A' - 1)),
+					 _mm_cmpgt_epi8(_mm_set1_epi8('Z' + 1), bytes)),
+				 _mm_and_si128(
+					 _mm_cmpgt_epi8(bytes, _mm_set1_epi8('a' - 1)),
+					 _mm_cmpgt_epi8(_mm_set1_epi8('z' + 1), bytes))),
+			 _mm_or_si128(
+				 _mm_and_si128(
+					 _mm_cmpgt_epi8(bytes, _mm_set1_epi8('0' - 1)),
+					 _mm_cmpgt_epi8(_mm_set1_epi8('9' + 1), bytes)),
+				 _mm_cmpeq_epi8(bytes, _mm_set1_epi8('_'))));
+		bits  = ~_mm_movemask_epi8(mask) & 0xffff;
+		if (bits != 0)
+		{
+			return from + __builtin_ctz(bits);
+		}
+		from += 16;
+	}
+#endif /* __SSE2__ */
+
+	while (from < src_len
+		&& (isalpha((unsigned char)src_buf[from]) || src_buf[from] == '_'
+			|| isdigit((unsigned char)src_buf[from])))
+	{
+		from++;
+	}
+
+	return from;
 }
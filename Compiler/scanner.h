@@ -28,4 +28,10 @@ void init_scanner(FILE *in_file);
  */
 void get_token(Token *token);
 
+/**
+ * Release the source buffer held by the scanner.  The source file itself must
+ * still be closed by the caller.
+ */
+void release_scanner(void);
+
 #endif /* SCANNER_H */
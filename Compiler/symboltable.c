@@ -18,16 +18,27 @@
 
 /* --- global static variables ---------------------------------------------- */
 
-static HashTab *table, *saved_table;
+static HashTab *table; /* the single scoped symbol table */
 
 static unsigned int curr_offset;
 
+/* The scope-undo log: identifiers inserted in the current subroutine scope
+ * are recorded here, and closing the scope replays the log to evict exactly
+ * those entries from the table.  Opening a scope is a marker push, so the
+ * per-subroutine table-init/teardown cycle disappears from the hot path.
+ */
+static char		  **scope_log;		/* identifiers inserted in open scopes */
+static unsigned int scope_log_len;	/* the number of logged identifiers    */
+static unsigned int scope_log_cap;	/* the capacity of the log             */
+static unsigned int scope_mark;		/* log length at the last scope open   */
+static Boolean		in_subroutine;	/* whether a scope is currently open   */
+
 /* --- function prototypes -------------------------------------------------- */
 
 static void			valstr(void *key, void *p, char *str);
 /*static void			freeprop(IDPropt *p);*/
-static unsigned int shift_hash(void *key, unsigned int size);
-static int			key_strcmp(void *val1, void *val2);
+static unsigned int id_hash(void *key, unsigned int size);
+static int			id_cmp(void *val1, void *val2);
 
 static void free_value(void *v);
 static void free_key(void *v);
@@ -40,16 +51,25 @@ void		keyval2str(void *k, void *v, char *b);
  */
 void init_symbol_table(void)
 {
-	saved_table = NULL;
-	if ((table = ht_init(0.75f, shift_hash, key_strcmp)) == NULL)
+	if ((table = ht_init_kind(HT_OPEN_ADDRESSING, 0.75f, id_hash, id_cmp))
+		== NULL)
 	{
 		eprintf("Symbol table could not be initialised");
 	}
 	curr_offset = 1;
+
+	scope_log_cap = 64;
+	scope_log	  = emalloc(scope_log_cap * sizeof(char *));
+	scope_log_len = 0;
+	scope_mark	  = 0;
+	in_subroutine = FALSE;
 }
 
 /**
- * @brief Opens a subroutine and initializes a new symbol table.
+ * @brief Opens a subroutine scope.
+ *
+ * The subroutine name is inserted at the global level, after which a scope
+ * marker is pushed onto the undo log; no new table is allocated.
  *
  * @param id The identifier of the subroutine.
  * @param prop Pointer to the ID property.
@@ -57,34 +77,35 @@ void init_symbol_table(void)
  */
 Boolean open_subroutine(char *id, IDPropt *prop)
 {
-	HashTab *temp;
 	if (!insert_name(id, prop))
 	{
 		return FALSE;
 	}
 
-	saved_table = table;
-
-	if ((temp = ht_init(0.75f, shift_hash, key_strcmp)) == NULL)
-	{
-		eprintf("Symbol table could not be initialised");
-	}
-	curr_offset = 0;
-
-	table = temp;
+	scope_mark	  = scope_log_len;
+	in_subroutine = TRUE;
+	curr_offset	  = 0;
 
 	return TRUE;
 
 }
 
 /**
- * @brief Closes the current subroutine and restores the previous symbol table.
+ * @brief Closes the current subroutine scope.
+ *
+ * The undo log is replayed down to the scope marker, evicting exactly the
+ * identifiers that were inserted in the scope; the global entries are left
+ * untouched.
  */
 void close_subroutine(void)
 {
-	ht_free(table, free_key, free_value);
+	while (scope_log_len > scope_mark)
+	{
+		scope_log_len--;
+		ht_remove(table, scope_log[scope_log_len]);
+	}
+	in_subroutine = FALSE;
 	curr_offset = 1;
-	table = saved_table;
 }
 
 /**
@@ -105,6 +126,15 @@ Boolean insert_name(char *id, IDPropt *prop)
 	{
 		return FALSE;
 	}
+	if (in_subroutine)
+	{
+		if (scope_log_len == scope_log_cap)
+		{
+			scope_log_cap *= 2;
+			scope_log = erealloc(scope_log, scope_log_cap * sizeof(char *));
+		}
+		scope_log[scope_log_len++] = id;
+	}
 	prop->offset = curr_offset;
 	if (IS_VARIABLE(prop->type))
 	{
@@ -123,16 +153,12 @@ Boolean insert_name(char *id, IDPropt *prop)
  */
 Boolean find_name(char *id, IDPropt **prop)
 {
-	/* TODO: Nothing, unless you want to. */
+	/* a single probe covers both scopes: while a subroutine scope is open,
+	 * the globals in the table are exactly the callables defined so far
+	 * (main's variables are only inserted after the last subroutine closes),
+	 * so the old callable-only visibility rule is preserved by construction
+	 */
 	*prop = ht_search(table, id);
-	if (!*prop && saved_table)
-	{
-		*prop = ht_search(saved_table, id);
-		if (*prop && !IS_CALLABLE_TYPE((*prop)->type))
-		{
-			*prop = NULL;
-		}
-	}
 
 	return (*prop ? TRUE : FALSE);
 }
@@ -141,8 +167,10 @@ int get_variables_width(void) { return curr_offset; }
 
 void release_symbol_table(void)
 {
-	ht_free(saved_table, free_key, free_value);
-	/* TODO: Free the underlying structures of the symbol table. */
+	ht_free(table, free_key, free_value);
+	free(scope_log);
+	scope_log	  = NULL;
+	scope_log_len = scope_log_cap = 0;
 }
 
 void print_symbol_table(void) { ht_print(table, valstr); }
@@ -188,64 +216,44 @@ static void freeprop(IDPropt *p)
 
 
 /**
- * @brief Compares two strings as keys for a hash table.
+ * @brief Compares two interned identifiers used as hash table keys.
  *
- * @param val1 The first string.
- * @param val2 The second string.
+ * Identifiers are interned (see intern.h), so each distinct identifier has
+ * exactly one canonical address, and comparing those addresses is equivalent
+ * to comparing the strings character by character.
+ *
+ * @param val1 The first interned identifier.
+ * @param val2 The second interned identifier.
  * @return An integer less than, equal to, or greater than zero if val1
  * is found to be less than, equal to, or greater than val2, respectively.
  */
-static int key_strcmp(void *val1, void *val2)
+static int id_cmp(void *val1, void *val2)
 {
-	char *str1;
-	char *str2;
-
-	str1 = (char *)val1;
-	str2 = (char *)val2;
-
-	return strcmp(str1, str2);
+	return (val1 == val2 ? 0 : (val1 < val2 ? -1 : 1));
 }
 
 
 /**
- * @brief Computes a hash value for a given key using a
- * shift-based hash function.
- * @param key The key for which to compute the hash value.
+ * @brief Computes a hash value for an interned identifier.
+ *
+ * Because each identifier has one canonical address, the address itself is a
+ * perfectly good hash input.  Arena addresses are aligned and closely spaced,
+ * so the raw bits cluster badly under open addressing; a 64-bit multiplicative
+ * mix (the golden-ratio constant) spreads them over the whole word before the
+ * reduction.
+ *
+ * @param key The interned identifier for which to compute the hash value.
  * @param size The size of the hash table.
  * @return The computed hash value as an unsigned integer.
  */
-static unsigned int shift_hash(void *key, unsigned int size)
+static unsigned int id_hash(void *key, unsigned int size)
 {
-#ifdef DEBUG_SYMBOL_TABLE
-	char		*keystr = (char *)key;
-	unsigned int i, hash, length;
+	unsigned long long hash;
 
-	hash   = 0;
-	length = strlen(keystr);
-	for (i = 0; i < length; i++)
-	{
-		hash += keystr[i];
-	}
+	hash = (unsigned long long)(size_t)key * 0x9e3779b97f4a7c15ULL;
+	hash ^= hash >> 32;
 
 	return (hash % size);
-#else
-	/* TODO insert your actual hash function here */
-
-	char *id;
-	int	  hash, i;
-
-	id	 = (char *)key;
-	hash = 0;
-
-	for (i = 0; i < (int)strlen(id); i++)
-	{
-		hash = (hash << 5 | hash >> 27);
-		hash += id[i];
-	}
-
-	return (hash % size);
-
-#endif /* DEBUG_SYMBOL_TABLE */
 }
 
 void keyval2str(void *k, void *v, char *b)
@@ -256,6 +264,9 @@ void keyval2str(void *k, void *v, char *b)
 	snprintf(b, 29, "Key: %s, Value: %s", key_str, value_str);
 }
 
-static void free_value(void *v) { free(v); }
+/* keys and values are arena-allocated (see arena.h), so there is nothing to
+ * release per entry; the arena is dropped in one call at end of compilation
+ */
+static void free_value(void *v) { (void)v; }
 
-static void free_key(void *v) { free(v); }
+static void free_key(void *v) { (void)v; }
@@ -0,0 +1,147 @@
+/**
+ * @file    tokenring.c
+ * @brief   A growable token lookahead ring between the scanner and the parser
+ *          of AMPL-2023.
+ * @date    2023-08-05
+ *
+ * The ring decouples scanning from parsing: whenever the parser runs out of
+ * buffered tokens, the scanner fills a whole batch ahead, which amortizes the
+ * per-call overhead of <code>get_token</code> and keeps the scanner's buffer
+ * state hot in cache.  Every entry carries the source position at which its
+ * token was scanned, and that position is restored on advance, so the
+ * parser's diagnostics are unaffected by the read-ahead.
+ */
+
+#include "tokenring.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "boolean.h"
+#include "error.h"
+#include "scanner.h"
+
+/** the initial ring capacity, which is also the batch fill size */
+#define INIT_RING_SIZE (64)
+
+/** a buffered token and the position at which it was scanned */
+typedef struct {
+	Token	  token; /* the token itself                  */
+	SourcePos pos;	 /* the source position of the token  */
+} RingEntry;
+
+/* --- global static variables ---------------------------------------------- */
+
+static RingEntry *ring;	   /* the ring storage                        */
+static int		  ringcap; /* the ring capacity                       */
+static int		  head;	   /* the index of the current token          */
+static int		  count;   /* the number of buffered tokens           */
+static Boolean	  hit_eof; /* whether the end-of-file token is queued */
+
+/* --- function prototypes -------------------------------------------------- */
+
+static void fill(void);
+static void grow(void);
+
+/* --- token ring interface ------------------------------------------------- */
+
+void init_token_ring(void)
+{
+	ringcap = INIT_RING_SIZE;
+	ring	= emalloc(ringcap * sizeof(RingEntry));
+	head	= 0;
+	count	= 0;
+	hit_eof = FALSE;
+}
+
+Token *peek_token(int k)
+{
+	while (k >= ringcap)
+	{
+		grow();
+	}
+
+	if (k >= count)
+	{
+		fill();
+	}
+
+	/* past the end of the source, yield the buffered end-of-file token */
+	if (k >= count)
+	{
+		k = count - 1;
+	}
+
+	return &ring[(head + k) % ringcap].token;
+}
+
+void next_token(Token *token)
+{
+	if (count == 0)
+	{
+		fill();
+		if (count == 0)
+		{
+			/* advanced past the end of the source */
+			token->type = TOK_EOF;
+			return;
+		}
+	}
+
+	*token	 = ring[head].token;
+	position = ring[head].pos;
+	head	 = (head + 1) % ringcap;
+	count--;
+}
+
+void release_token_ring(void)
+{
+	free(ring);
+	ring  = NULL;
+	count = 0;
+}
+
+/* --- utility functions ---------------------------------------------------- */
+
+/**
+ * Fills the ring with a batch of tokens, stopping at the ring capacity or
+ * after buffering the end-of-file token.
+ */
+static void fill(void)
+{
+	RingEntry *entry;
+
+	while (count < ringcap && !hit_eof)
+	{
+		entry = &ring[(head + count) % ringcap];
+		get_token(&entry->token);
+		entry->pos = position;
+		count++;
+
+		if (entry->token.type == TOK_EOF)
+		{
+			hit_eof = TRUE;
+		}
+	}
+}
+
+/**
+ * Doubles the ring capacity, laying the buffered tokens out from the start of
+ * the new storage.
+ */
+static void grow(void)
+{
+	RingEntry *bigger;
+	int		   i;
+
+	bigger = emalloc(2 * ringcap * sizeof(RingEntry));
+	for (i = 0; i < count; i++)
+	{
+		bigger[i] = ring[(head + i) % ringcap];
+	}
+
+	free(ring);
+	ring	= bigger;
+	ringcap = 2 * ringcap;
+	head	= 0;
+}
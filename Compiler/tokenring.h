@@ -0,0 +1,46 @@
+/**
+ * @file    tokenring.h
+ * @brief   A growable token lookahead ring between the scanner and the parser
+ *          of AMPL-2023.
+ * @date    2023-08-05
+ */
+
+#ifndef TOKENRING_H
+#define TOKENRING_H
+
+#include "token.h"
+
+/**
+ * Initialise the token ring.  This must be called after
+ * <code>init_scanner</code>, and before the first token is requested.
+ */
+void init_token_ring(void);
+
+/**
+ * Peek at a token ahead of the current one without consuming anything.  The
+ * ring grows as necessary, so any lookahead distance is valid; peeking past
+ * the end of the source yields the end-of-file token.
+ *
+ * @param[in]   k
+ *     the lookahead distance, where zero denotes the current token
+ * @return
+ *     a pointer to the token, which remains valid until the next advance
+ */
+Token *peek_token(int k);
+
+/**
+ * Get the current token and advance the ring.  The global source position is
+ * restored to the position at which the token was scanned, so diagnostics
+ * behave as if the token had just been read.
+ *
+ * @param[out]  token
+ *     contains the token just consumed
+ */
+void next_token(Token *token);
+
+/**
+ * Release the resources held by the token ring.
+ */
+void release_token_ring(void);
+
+#endif /* TOKENRING_H */
@@ -1,22 +1,96 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 #include <mpi.h>
+#include <pthread.h>
 #include <arpa/inet.h>
 #include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
 #include "comms.h"
 
 #define EMPTY -1
 #define BLACK 0
 #define WHITE 1
+#define CANDIDATE 3
 
 
 #define MAX_MOVES 361
 
+/* iterative deepening bounds: fraction of the per-move time budget to spend
+ * before refusing to start another iteration, and a depth cap */
+#define TIME_SAFETY 0.9
+#define MAX_SEARCH_DEPTH 8
+
+/* threads per worker rank, overridable through PLAYER_THREADS */
+#define WORKER_THREADS_DEFAULT 4
+
+/* message tags: tasks and results on TAG_TASK, asynchronous root-bound
+ * pushes from the master on TAG_BOUND */
+#define TAG_TASK 0
+#define TAG_BOUND 1
+
+/* broadcast control codes: start a search round (carrying a two-move board
+ * delta instead of the whole board), reset for a new match, or shut down */
+#define CTRL_ROUND 0
+#define CTRL_RESET 1
+#define CTRL_TERMINATE 2
+
+/* bitboard addressing: cell pos lives in bit (pos & 63) of word (pos >> 6) */
+#define BB_WORD(pos) ((pos) >> 6)
+#define BB_BIT(pos)  (1ULL << ((pos) & 63))
+#define MAX_WORDS ((MAX_MOVES + 63) / 64)
+
+/* transposition table: entries per worker (power of two, ~24 MB) */
+#define TT_SIZE (1 << 20)
+
+#define TT_EXACT 0
+#define TT_LOWER 1
+#define TT_UPPER 2
+
+/* opening book: entries kept across matches in a memory-mapped file */
+#define BOOK_SIZE (1 << 16)
+#define BOOK_MIN_DEPTH 4
+#define BOOK_MAX_PLY 12
+
+/* one undo record per stone placed by update_adjacent, so remove_adjacent
+ * can reverse exactly the candidate-set changes that placement made */
+typedef struct {
+	int move;           /* the stone that was placed */
+	int was_candidate;  /* whether that square was in the candidate set */
+	int nadded;         /* neighbours newly added to the set */
+	int added[8];
+} UndoFrame;
+
+typedef struct {
+	uint64_t key;   /* full Zobrist key, for collision detection */
+	int score;      /* minimax value relative to the node, as bounded by flag */
+	short best;     /* best child cell, for move ordering on re-visits */
+	char depth;     /* remaining depth the entry was searched to */
+	char flag;      /* TT_EXACT, TT_LOWER or TT_UPPER */
+} TTEntry;
+
+typedef struct {
+	uint64_t key;   /* full Zobrist key of the position, side to move folded in */
+	int move;       /* the move the search settled on from this position */
+	int depth;      /* the depth that iteration completed */
+} BookEntry;
+
+typedef struct {
+	long nodes;     /* nodes searched across all iterations */
+	long cutoffs;   /* beta cutoffs across all iterations */
+	int depth;      /* deepest iteration that completed */
+	double seconds; /* wall time the search took */
+} SearchStats;
+
 const char *PLAYER_NAME_LOG = "my_player1.log";
 
 void run_master(int, char *[], int);
 int initialise_master(int, char *[], int *, int *, FILE **);
+int master_search(int, int, double, int, FILE *, SearchStats *);
+void run_benchmark(int, char *[], int);
 
 void initialise_board(void);
 void free_board(void);
@@ -24,37 +98,139 @@ void print_board(FILE *);
 void reset_board(FILE *);
 
 void run_worker(int);
+void poll_bounds(void);
 void update_adjacent(int, int);
+void remove_adjacent(int);
 
 int random_strategy(int, FILE *);
 int evaluate(int, int);
 int minimax(int, int, int, int ,int, int);
+int search_root(int, int, int, int, int);
 void legal_moves(int *, int *);
 void make_move(int, int);
-
-int *board;
+int cell_at(int);
+int has_stone(int);
+int stone_count(int);
+void init_zobrist(void);
+void add_candidate(int);
+void del_candidate(int);
+void dirty_lines(int);
+void book_open(void);
+void book_close(void);
+int book_probe(int);
+void book_store(int, int, int);
+void bb_shift_down(uint64_t *, const uint64_t *, int);
+void bb_shift_up(uint64_t *, const uint64_t *, int);
+void threat_scan(int, uint64_t *);
+
+/* The board is three bitboards over one backing block: one word array of
+ * stones per colour, and one word array marking the candidate (adjacent)
+ * cells the search expands.  One bit per cell instead of an int shrinks the
+ * board broadcast to the workers by a factor of 16. */
+uint64_t *bitboards;
+int board_words;
+
+/* All mutable search state lives in a context, so each thread of a worker
+ * rank can search its own copy of the position: the stone and candidate
+ * bitboards, the compact candidate list with its index-of-position map and
+ * undo stack (make/unmake is O(adjacent cells) rather than a board scan),
+ * the incrementally maintained Zobrist key, the killer/history ordering
+ * tables, and the per-cell evaluation cache.  The master and each worker's
+ * main thread use main_search, whose bitboards alias the broadcast block;
+ * pool threads search private copies. */
+typedef struct {
+	uint64_t *stones[2];
+	uint64_t *candidates;
+	uint64_t board_hash;
+	int cand_list[MAX_MOVES];
+	int cand_index[MAX_MOVES];
+	int cand_count;
+	UndoFrame undo_stack[MAX_MOVES];
+	int undo_top;
+	int killer[MAX_SEARCH_DEPTH + 1][2];
+	int history[MAX_MOVES];
+	int eval_cache[2][MAX_MOVES];
+	unsigned char eval_valid[2][MAX_MOVES];
+	long nodes;
+	long cutoffs;
+} SearchContext;
+
+SearchContext main_search;
+__thread SearchContext *ctx;
+
+/* Zobrist hashing: one random word per colour per cell, xor'ed into the
+ * context's board_hash as stones are placed and removed, so hypothetical
+ * moves in the search update the position key incrementally. */
+uint64_t zobrist[2][MAX_MOVES];
+uint64_t zobrist_side;
+
+/* the transposition table is shared by all threads of a worker rank; the
+ * stored key filters out entries a concurrent writer is replacing */
+TTEntry *tt;
+
+/* the opening book persists across processes and tournament matches: the
+ * master maps it MAP_SHARED from a file, so positions searched in one game
+ * answer instantly when the same opening comes up in a later one */
+BookEntry *book;
+int book_fd = -1;
+
+/* row/column lookup tables, so the evaluation walk needs no divisions */
+int row_of[MAX_MOVES];
+int col_of[MAX_MOVES];
+
+/* per-step validity masks for the threat scan: bit c of step_fwd_mask[j] is
+ * set when a j-step forward walk from c passes evaluate's boundary checks
+ * (col + j < N and row + j < N), and step_bwd_mask[j] likewise for the
+ * backward walk.  The checks do not depend on the direction. */
+uint64_t step_fwd_mask[5][MAX_WORDS];
+uint64_t step_bwd_mask[5][MAX_WORDS];
+
+int worker_threads = WORKER_THREADS_DEFAULT;
+
+/* latest root bound pushed by the master for the current round, read by
+ * every search thread; only the main thread talks to MPI, so polling is
+ * funnelled through it */
+volatile int pushed_bound = -10000;
+int bound_seq;
+long poll_count;
+
+/* the two-move board delta carried by the next round broadcast, indexed by
+ * colour: the master records moves here as they are played, and the broadcast
+ * flushes them to the worker mirrors.  master_colour is the colour the
+ * workers call their own, so the delta slots map consistently. */
+int pending[2] = {-1, -1};
+int master_colour;
+int round_seq;
 
 int BOARD_SIZE;
 
 int main(int argc, char *argv[]) {
 	int rank, size;
-	
-	if (argc != 6) {
+	int bench = (argc >= 2 && strcmp(argv[1], "-bench") == 0);
+
+	if (!bench && argc != 6) {
 		printf("Usage: %s <inetaddress> <port> <time_limit> <player_colour> <board_size>\n", argv[0]);
+		printf("       %s -bench <board_size> <max_depth> <plies> [seconds_per_move]\n", argv[0]);
 		return 1;
 	}
-	
-	MPI_Init(&argc, &argv);
+
+	int provided;
+	MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
 	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
 	MPI_Comm_size(MPI_COMM_WORLD, &size);
 
 	/* each process initialises their own board */
-	BOARD_SIZE = atoi(argv[5]);
+	BOARD_SIZE = bench ? ((argc > 2) ? atoi(argv[2]) : 19) : atoi(argv[5]);
 	initialise_board();
-	
+	init_zobrist();
+
 
 	if (rank == 0) {
-		run_master(argc, argv, size);
+		if (bench) {
+			run_benchmark(argc, argv, size);
+		} else {
+			run_master(argc, argv, size);
+		}
 	} else {
 		run_worker(rank);
 	}
@@ -72,94 +248,45 @@ int main(int argc, char *argv[]) {
  * @param argv command line argument vector
 */
 void run_master(int argc, char *argv[], int size) {
-	int msg_type, time_limit, my_move, opp_move, running, count, NO_MORE_TASKS, max, TERMINATE, alpha;
-	int tot_tasks, my_colour, send[3];
+	int msg_type, time_limit, my_move, opp_move, running;
+	int my_colour, send[5], control[3];
 	FILE *fp;
-	char *move; 
-	int *search;
-	int tracking[size];
-
-	//Initial values and Constants
-	NO_MORE_TASKS = -5;
-	TERMINATE = -123;
-	alpha = -10000;
+	char *move;
 
 	running = initialise_master(argc, argv, &time_limit, &my_colour, &fp);
+	book_open();
 
+	master_colour = my_colour;
 	MPI_Bcast(&my_colour, 1, MPI_INT, 0, MPI_COMM_WORLD);
 
-	search = (int *)malloc(BOARD_SIZE * BOARD_SIZE * sizeof(int));
-	
-    for (int i = 0; i < BOARD_SIZE * BOARD_SIZE; i++) {
-		search[i] = -1;
-    }
-	
 	while (running) {
 		msg_type = receive_message(&opp_move);
 		if (msg_type == GENERATE_MOVE) { /* referee is asking for a move */
-			count = 0;
-
-			for (int i = 0; i < BOARD_SIZE * BOARD_SIZE; i++) {
-        		if (board[i] == 3) {
-					search[count++] = i;
-				}
-    		}
-			count--;
-			tot_tasks = count+1;
-
-			if ((search[0]) == -1) {
+			if (ctx->cand_count == 0) {
 				my_move = (BOARD_SIZE*BOARD_SIZE)/2;
+			} else if ((my_move = book_probe(my_colour)) >= 0) {
+				/* known opening: answer from the book, but still run an
+				 * empty round so the worker mirrors pick up the delta */
+				fprintf(fp, "book hit: move %d\n", my_move);
+				control[0] = CTRL_ROUND;
+				control[1] = pending[master_colour];
+				control[2] = pending[(master_colour + 1) % 2];
+				MPI_Bcast(control, 3, MPI_INT, 0, MPI_COMM_WORLD);
+				pending[0] = -1;
+				pending[1] = -1;
+				send[0] = -5;
+				for (int i = 1; i < size; i++) {
+					MPI_Send(&send, 5, MPI_INT, i, TAG_TASK, MPI_COMM_WORLD);
+				}
 			} else {
-					MPI_Bcast(&NO_MORE_TASKS, 1, MPI_INT, 0, MPI_COMM_WORLD);
-					MPI_Bcast(board, BOARD_SIZE * BOARD_SIZE, MPI_INT, 0, MPI_COMM_WORLD);
-					
-					send[1] = alpha;
-					if (count < 15) {
-						send[2] = 4;
-					} else if (count < 30) {
-						send[2] = 3;
-					} else {
-						send[2] = 2;
-					} 
-					
-					for (int i = 1; i < size; i++) {
-						if (count < 0) break;
-						send[0] = search[count];
-						MPI_Send(&send, 3, MPI_INT, i, 0, MPI_COMM_WORLD);
-						tracking[i] = search[count];
-						my_move = search[count];
-						count--;
-    				}
-					int results_received = 0;
-					max = -10000;
-					while (results_received < tot_tasks) { 
-						int result;
-        				MPI_Status status;
-
-        				MPI_Recv(&result, 1, MPI_INT, MPI_ANY_SOURCE, 0, MPI_COMM_WORLD, &status); 
-        				results_received++;
-        				int worker_rank = status.MPI_SOURCE;
-						
-						if (result > max) {
-							max = result;
-							my_move = tracking[worker_rank];
-						}
-
-						if (count >= 0) {
-							send[0] = search[count];
-							send[1] = max;
-							MPI_Send(&send, 3, MPI_INT, worker_rank, 0, MPI_COMM_WORLD);
-							tracking[worker_rank] = search[count];
-            				count--;
-        				} else {
-							send[0] = -5;
-							MPI_Send(&send, 3, MPI_INT, worker_rank, 0, MPI_COMM_WORLD);
-						}
-					}
+				my_move = master_search(my_colour, MAX_SEARCH_DEPTH,
+						MPI_Wtime() + TIME_SAFETY * time_limit, size, fp,
+						NULL);
 			}
 
 			update_adjacent(my_move, my_colour);
 			make_move(my_move, my_colour);
+			pending[my_colour] = my_move;
 
 			/* convert move to char */
 			move = malloc(sizeof(char) * 10);
@@ -169,18 +296,25 @@ void run_master(int argc, char *argv[], int size) {
 
 		} else if (msg_type == PLAY_MOVE) { /* referee is forwarding opponents move */
 			fprintf(fp, "\nOpponent placing piece in column: %d, row %d\n", opp_move/BOARD_SIZE, opp_move%BOARD_SIZE);
-			make_move(opp_move, (my_colour + 1) % 2);  
+			make_move(opp_move, (my_colour + 1) % 2);
 			update_adjacent(opp_move, (my_colour + 1) % 2);
+			pending[(my_colour + 1) % 2] = opp_move;
 		} else if (msg_type == GAME_TERMINATION) { /* reset the board */
 			fprintf(fp, "Game terminated.\n");
 			fflush(fp);
 			running = 0;
-			MPI_Bcast(&TERMINATE, 1, MPI_INT, 0, MPI_COMM_WORLD);
+			control[0] = CTRL_TERMINATE;
+			control[1] = -1;
+			control[2] = -1;
+			MPI_Bcast(control, 3, MPI_INT, 0, MPI_COMM_WORLD);
 		} else if (msg_type == MATCH_RESET) { /* game is over */
 			reset_board(fp);
-			for (int i = 0; i < BOARD_SIZE * BOARD_SIZE; i++) {
-				search[i] = -1;
-    		}
+			pending[0] = -1;
+			pending[1] = -1;
+			control[0] = CTRL_RESET;
+			control[1] = -1;
+			control[2] = -1;
+			MPI_Bcast(control, 3, MPI_INT, 0, MPI_COMM_WORLD);
 		} else if (msg_type == UNKNOWN) {
 			fprintf(fp, "Received unknown message type from referee.\n");
 			fflush(fp);
@@ -189,8 +323,195 @@ void run_master(int argc, char *argv[], int size) {
 
 		if (msg_type == GENERATE_MOVE || msg_type == PLAY_MOVE || msg_type == MATCH_RESET) print_board(fp);
 	}
-	
-	free(search);
+
+	book_close();
+}
+
+/**
+ * Searches the current position for the given side with iterative deepening,
+ * farming the root moves out to the worker ranks, or searching them locally
+ * when there are no workers.  Each depth runs one task-distribution round:
+ * the board delta is broadcast, root moves are handed to workers as they
+ * come free, and improved bounds are pushed to the tasks in flight.  The
+ * best move of the last completed iteration is returned, and recorded in
+ * the opening book when one is mapped.
+ *
+ * @param side the colour to move
+ * @param max_depth the deepest iteration to attempt
+ * @param deadline the MPI_Wtime() value at which the search must stop
+ * @param size number of MPI ranks
+ * @param fp log file for the per-depth statistics
+ * @param stats node, cutoff, depth and time figures; may be NULL
+ * @return the move to play
+*/
+int master_search(int side, int max_depth, double deadline, int size,
+		FILE *fp, SearchStats *stats) {
+	int my_move, count, max;
+	int send[5], bnd[2], control[3];
+	int search[MAX_MOVES];
+	int tracking[size];
+	MPI_Request reqs[size];
+	int replies[size][3];
+	double t_start = MPI_Wtime();
+	long prev_nodes = 0;
+	long total_nodes = 0, total_cutoffs = 0;
+	int completed = 0;
+
+	for (int i = 0; i < size; i++) {
+		reqs[i] = MPI_REQUEST_NULL;
+	}
+
+	count = ctx->cand_count;
+	memcpy(search, ctx->cand_list, ctx->cand_count * sizeof(int));
+	my_move = search[count - 1];
+
+	for (int depth = 1; depth <= max_depth; depth++) {
+		double t_iter = MPI_Wtime();
+		long iter_nodes = 0;
+		long iter_cutoffs = 0;
+		int aborted = 0;
+		int iter_best = -1;
+		int next = count - 1;
+		int assigned = 0;
+		int results_received = 0;
+
+		/* send the board as a two-move delta: our previous move and the
+		 * opponent's, applied incrementally by the workers; later
+		 * iterations carry no delta at all */
+		control[0] = CTRL_ROUND;
+		control[1] = pending[master_colour];
+		control[2] = pending[(master_colour + 1) % 2];
+		MPI_Bcast(control, 3, MPI_INT, 0, MPI_COMM_WORLD);
+		pending[0] = -1;
+		pending[1] = -1;
+
+		round_seq++;
+		send[1] = -10000;
+		send[2] = depth;
+		send[3] = round_seq;
+		send[4] = side;
+		max = -10000;
+
+		if (size == 1) {
+			/* no workers: handle the root tasks locally, exactly as a
+			 * worker would, tightening the bound between tasks */
+			memset(ctx->history, 0, sizeof(ctx->history));
+			memset(ctx->killer, -1, sizeof(ctx->killer));
+			ctx->nodes = 0;
+			ctx->cutoffs = 0;
+			for (int c = count - 1; c >= 0 && !aborted; c--) {
+				int result = evaluate(search[c], side);
+				if (result < 3000) {
+					update_adjacent(search[c], side);
+					result += search_root(depth, max, 10000,
+							(side + 1) % 2, result);
+					remove_adjacent(search[c]);
+				} else {
+					result += 5000;
+				}
+				if (result > max) {
+					max = result;
+					iter_best = search[c];
+				}
+				if (MPI_Wtime() >= deadline) aborted = 1;
+			}
+			iter_nodes = ctx->nodes;
+			iter_cutoffs = ctx->cutoffs;
+		} else {
+			for (int i = 1; i < size; i++) {
+				if (next >= 0) {
+					send[0] = search[next];
+					MPI_Send(&send, 5, MPI_INT, i, TAG_TASK, MPI_COMM_WORLD);
+					MPI_Irecv(replies[i], 3, MPI_INT, i, TAG_TASK,
+							MPI_COMM_WORLD, &reqs[i]);
+					tracking[i] = search[next];
+					next--;
+					assigned++;
+				} else {
+					/* idle workers go straight back to the next
+					 * broadcast */
+					send[0] = -5;
+					MPI_Send(&send, 5, MPI_INT, i, TAG_TASK, MPI_COMM_WORLD);
+					tracking[i] = -1;
+				}
+			}
+			while (results_received < assigned) {
+				int worker_rank;
+				MPI_Status status;
+
+				MPI_Waitany(size, reqs, &worker_rank, &status);
+				results_received++;
+				iter_nodes += replies[worker_rank][1];
+				iter_cutoffs += replies[worker_rank][2];
+
+				if (replies[worker_rank][0] > max) {
+					max = replies[worker_rank][0];
+					iter_best = tracking[worker_rank];
+					/* push the improved bound to every in-flight
+					 * worker right away, so bad subtrees cut off
+					 * before their task completes */
+					bnd[0] = round_seq;
+					bnd[1] = max;
+					for (int i = 1; i < size; i++) {
+						if (i != worker_rank && tracking[i] >= 0) {
+							MPI_Send(bnd, 2, MPI_INT, i, TAG_BOUND,
+									MPI_COMM_WORLD);
+						}
+					}
+				}
+
+				if (MPI_Wtime() >= deadline) aborted = 1;
+				if (next >= 0 && !aborted) {
+					send[0] = search[next];
+					send[1] = max;
+					MPI_Send(&send, 5, MPI_INT, worker_rank, TAG_TASK, MPI_COMM_WORLD);
+					MPI_Irecv(replies[worker_rank], 3, MPI_INT,
+							worker_rank, TAG_TASK, MPI_COMM_WORLD,
+							&reqs[worker_rank]);
+					tracking[worker_rank] = search[next];
+					next--;
+					assigned++;
+				} else {
+					send[0] = -5;
+					MPI_Send(&send, 5, MPI_INT, worker_rank, TAG_TASK, MPI_COMM_WORLD);
+					tracking[worker_rank] = -1;
+				}
+			}
+		}
+
+		total_nodes += iter_nodes;
+		total_cutoffs += iter_cutoffs;
+
+		if (aborted) {
+			fprintf(fp, "depth %d aborted after %.3fs\n", depth,
+					MPI_Wtime() - t_start);
+			break;
+		}
+
+		if (iter_best >= 0) my_move = iter_best;
+		completed = depth;
+		fprintf(fp, "depth %d: %ld nodes in %.3fs", depth,
+				iter_nodes, MPI_Wtime() - t_iter);
+		if (prev_nodes > 0) {
+			fprintf(fp, " (ebf %.2f)",
+					(double)iter_nodes / prev_nodes);
+		}
+		fprintf(fp, ", best %d, score %d\n", my_move, max);
+		prev_nodes = iter_nodes;
+
+		if (MPI_Wtime() >= deadline) break;
+	}
+
+	if (completed >= BOOK_MIN_DEPTH) {
+		book_store(side, my_move, completed);
+	}
+	if (stats != NULL) {
+		stats->nodes = total_nodes;
+		stats->cutoffs = total_cutoffs;
+		stats->depth = completed;
+		stats->seconds = MPI_Wtime() - t_start;
+	}
+	return my_move;
 }
 
 /**
@@ -200,34 +521,159 @@ void run_master(int argc, char *argv[], int size) {
 */
 void run_worker(int rank) {
 	
-	int task, my_colour, terminate, alpha, receive[3], result;
+	int my_colour, control[3], receive[5], reply[3], result;
 
 	MPI_Bcast(&my_colour, 1, MPI_INT, 0, MPI_COMM_WORLD);
 	int opp_colour = (my_colour + 1) % 2;
-	
+	char *threads_env = getenv("PLAYER_THREADS");
+
+	if (threads_env != NULL && atoi(threads_env) > 0) {
+		worker_threads = atoi(threads_env);
+	}
+	tt = calloc(TT_SIZE, sizeof(TTEntry));
+
 	while (1) {
-		task = 0;
-		MPI_Bcast(&terminate, 1, MPI_INT, 0, MPI_COMM_WORLD);
-		if (terminate == -123) break;
-		MPI_Bcast(board, BOARD_SIZE * BOARD_SIZE, MPI_INT, 0, MPI_COMM_WORLD);
+		MPI_Bcast(control, 3, MPI_INT, 0, MPI_COMM_WORLD);
+		if (control[0] == CTRL_TERMINATE) break;
+		if (control[0] == CTRL_RESET) {
+			/* new match: fresh board, and a fresh table, since the same
+			 * Zobrist keys will name different games' positions */
+			free_board();
+			initialise_board();
+			memset(tt, 0, TT_SIZE * sizeof(TTEntry));
+			continue;
+		}
+		/* apply the round's board delta to the local mirror; the first
+		 * round of a move carries the last two real moves, later rounds
+		 * none */
+		if (control[1] >= 0) update_adjacent(control[1], my_colour);
+		if (control[2] >= 0) update_adjacent(control[2], opp_colour);
+		memset(ctx->history, 0, sizeof(ctx->history));
+		memset(ctx->killer, -1, sizeof(ctx->killer));
 		while (1) {
-			MPI_Recv(&receive, 3, MPI_INT, 0, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-			if (receive[0] == -5) break;  
-    		
-			result = evaluate(receive[0], my_colour);
+			MPI_Recv(&receive, 5, MPI_INT, 0, TAG_TASK, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+			if (receive[0] == -5) break;
+
+			/* the side to move at the root travels with the task, so the
+			 * benchmark driver can farm out either colour's moves */
+			int side = receive[4];
+			ctx->nodes = 0;
+			ctx->cutoffs = 0;
+			bound_seq = receive[3];
+			pushed_bound = receive[1];
+			poll_bounds();
+			result = evaluate(receive[0], side);
 			if (result < 3000) {
-				update_adjacent(receive[0], my_colour);
-				result += minimax(receive[2], 0, receive[1], 10000, opp_colour, result);
-				remove_adjacent(receive[0]);				
+				update_adjacent(receive[0], side);
+				result += search_root(receive[2], receive[1], 10000, (side + 1) % 2, result);
+				remove_adjacent(receive[0]);
 			} else {
 				result += 5000;
 			}
-        	MPI_Send(&result, 1, MPI_INT, 0, 0, MPI_COMM_WORLD); 
+			reply[0] = result;
+			reply[1] = (int)ctx->nodes;
+			reply[2] = (int)ctx->cutoffs;
+        	MPI_Send(reply, 3, MPI_INT, 0, TAG_TASK, MPI_COMM_WORLD);
+		}
+
+	}
+
+	free(tt);
+	tt = NULL;
+}
+
+/**
+ * Drains any pending bound pushes from the master and keeps the best one
+ * for the current round.  Called from the worker's main thread only, so the
+ * MPI_THREAD_FUNNELED contract holds.
+*/
+void poll_bounds(void) {
+	int flag, msg[2];
+
+	while (1) {
+		MPI_Iprobe(0, TAG_BOUND, MPI_COMM_WORLD, &flag, MPI_STATUS_IGNORE);
+		if (!flag) break;
+		MPI_Recv(msg, 2, MPI_INT, 0, TAG_BOUND, MPI_COMM_WORLD,
+				MPI_STATUS_IGNORE);
+		if (msg[0] == bound_seq && msg[1] > pushed_bound) {
+			pushed_bound = msg[1];
 		}
-		
 	}
 }
 
+/**
+ * Plays the engine against itself with no referee attached, and reports the
+ * figures a search change should be judged by: nodes per second, cutoff
+ * rate, and the per-depth time-to-depth lines of every iteration.  Running
+ * the same configuration at -np 1 gives the serial baseline for computing
+ * MPI scaling efficiency.
+ *
+ * Usage: my_player -bench <board_size> <max_depth> <plies> [seconds_per_move]
+ *
+ * @param argc command line argument count
+ * @param argv command line argument vector
+ * @param size number of MPI ranks
+*/
+void run_benchmark(int argc, char *argv[], int size) {
+	int max_depth = (argc > 3) ? atoi(argv[3]) : 6;
+	int plies = (argc > 4) ? atoi(argv[4]) : 8;
+	if (max_depth < 1) max_depth = 1;
+	/* the killer table only has MAX_SEARCH_DEPTH + 1 rows */
+	if (max_depth > MAX_SEARCH_DEPTH) max_depth = MAX_SEARCH_DEPTH;
+	double budget = (argc > 5) ? atof(argv[5]) : 30.0;
+	int my_colour = BLACK;
+	int my_move, control[3];
+	long total_nodes = 0, total_cutoffs = 0;
+	double t_start, elapsed;
+	SearchStats st;
+	char *threads_env = getenv("PLAYER_THREADS");
+
+	if (threads_env != NULL && atoi(threads_env) > 0) {
+		worker_threads = atoi(threads_env);
+	}
+	tt = calloc(TT_SIZE, sizeof(TTEntry));
+	master_colour = my_colour;
+	MPI_Bcast(&my_colour, 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+	printf("bench: board %d, depth %d, %d plies, %.1fs budget, %d ranks x %d threads\n",
+			BOARD_SIZE, max_depth, plies, budget, size, worker_threads);
+	t_start = MPI_Wtime();
+
+	my_move = (BOARD_SIZE * BOARD_SIZE) / 2;
+	update_adjacent(my_move, BLACK);
+	make_move(my_move, BLACK);
+	pending[BLACK] = my_move;
+
+	for (int ply = 1; ply < plies; ply++) {
+		int side = ply % 2;
+
+		my_move = master_search(side, max_depth, MPI_Wtime() + budget, size,
+				stdout, &st);
+		printf("ply %d: %s plays %d, depth %d, %ld nodes in %.3fs, %.0f nodes/s, %.3f cutoffs/node\n",
+				ply, side == BLACK ? "black" : "white", my_move, st.depth,
+				st.nodes, st.seconds, st.nodes / st.seconds,
+				(double)st.cutoffs / st.nodes);
+		total_nodes += st.nodes;
+		total_cutoffs += st.cutoffs;
+
+		update_adjacent(my_move, side);
+		make_move(my_move, side);
+		pending[side] = my_move;
+	}
+
+	control[0] = CTRL_TERMINATE;
+	control[1] = -1;
+	control[2] = -1;
+	MPI_Bcast(control, 3, MPI_INT, 0, MPI_COMM_WORLD);
+
+	elapsed = MPI_Wtime() - t_start;
+	printf("total: %ld nodes in %.3fs, %.0f nodes/s, %.3f cutoffs/node\n",
+			total_nodes, elapsed, total_nodes / elapsed,
+			(double)total_cutoffs / total_nodes);
+	free(tt);
+	tt = NULL;
+}
+
 
 /**
  * Evaluates the board positions using minimax with alpha beta pruning.
@@ -241,61 +687,392 @@ void run_worker(int rank) {
 */
 int minimax(int depth, int turn, int alpha, int beta, int color, int cumulative) {
 	int value, temp, total;
-	int bestValue;
+	int bestValue, bestMove;
+	int cand[MAX_MOVES];
+	int ncand = 0;
+	int cutoff = 0;
+	int alpha_in = alpha, beta_in = beta;
+	uint64_t key;
+	TTEntry *entry = NULL;
+	int tt_move = -1;
 	value = 0;
  	bestValue = -10000;
+	bestMove = -1;
+	ctx->nodes++;
+
+	/* pick up bound pushes from the master: the main thread polls every
+	 * 1024 nodes, and every thread tightens its window from the shared
+	 * bound, which lives in the same cumulative score space as alpha */
+	if (ctx == &main_search && (++poll_count & 1023) == 0) poll_bounds();
+	if (pushed_bound > alpha) alpha = pushed_bound;
+
+	/* probe the transposition table; node scores are relative to the node,
+	 * so bounds are compared against the window with cumulative added back */
+	key = ctx->board_hash ^ (color == WHITE ? zobrist_side : 0);
+	if (tt != NULL) {
+		entry = &tt[key & (TT_SIZE - 1)];
+		if (entry->key == key) {
+			if (entry->depth >= depth) {
+				if (entry->flag == TT_EXACT) return entry->score;
+				if (entry->flag == TT_LOWER
+						&& cumulative + entry->score >= beta) {
+					return entry->score;
+				}
+				if (entry->flag == TT_UPPER
+						&& cumulative + entry->score <= alpha) {
+					return entry->score;
+				}
+			}
+			tt_move = entry->best;
+		}
+	}
+
+	/* word-parallel screen before expanding: a winning cell for the mover
+	 * decides the node outright, and the opponent's winning cells are kept
+	 * to pull the blocking moves to the front of the ordering.  A colour
+	 * with fewer than four stones down cannot complete five, so the scans
+	 * only run once a line is possible, and the ordering scan only where
+	 * the subtree is big enough for ordering to matter */
+	uint64_t threat[MAX_WORDS];
+	int have_threats = 0;
+	if (depth >= 1 && stone_count(color) >= 4) {
+		threat_scan(color, threat);
+		for (int w = 0; w < board_words; w++) {
+			if (threat[w] & ctx->candidates[w]) {
+				return turn == 1 ? 3000 : -3000;
+			}
+		}
+	}
+	if (depth >= 2 && stone_count((color + 1) % 2) >= 4) {
+		threat_scan((color + 1) % 2, threat);
+		have_threats = 1;
+	}
+
+	/* snapshot the candidate list: the recursion below edits it in place
+	 * while the node is being expanded */
+	ncand = ctx->cand_count;
+	memcpy(cand, ctx->cand_list, ctx->cand_count * sizeof(int));
+
+	/* order the candidates: static evaluation plus history, killer moves
+	 * for this depth above that, and the table move in front of everything;
+	 * the static scores are kept so the loops below need not re-evaluate */
+	int meval[MAX_MOVES], mscore[MAX_MOVES];
+	for (int c = 0; c < ncand; c++) {
+		int i = cand[c];
+		meval[c] = evaluate(i, color);
+		mscore[c] = meval[c] * 16 + ctx->history[i];
+		if (have_threats && (threat[BB_WORD(i)] & BB_BIT(i))) mscore[c] += 1 << 16;
+		if (i == ctx->killer[depth][0] || i == ctx->killer[depth][1]) {
+			mscore[c] += 1 << 20;
+		}
+		if (i == tt_move) mscore[c] += 1 << 24;
+	}
+	for (int c = 1; c < ncand; c++) {
+		int s = mscore[c], e = meval[c], m = cand[c];
+		int j = c - 1;
+		while (j >= 0 && mscore[j] < s) {
+			mscore[j+1] = mscore[j];
+			meval[j+1] = meval[j];
+			cand[j+1] = cand[j];
+			j--;
+		}
+		mscore[j+1] = s;
+		meval[j+1] = e;
+		cand[j+1] = m;
+	}
 
 	if (turn == 1) {
-		for (int i = 0; i < BOARD_SIZE*BOARD_SIZE; i++) {
-			if (board[i] == 3) {
-				temp = evaluate(i, color);
-				if (temp >= 3000) return 3000;
-
-				total = cumulative + temp;
-			
-				if (depth > 0) {
-					update_adjacent(i, color);
-					value = minimax(depth-1, 0, alpha, beta, (color + 1) % 2, total);	
-					remove_adjacent(i);
-				} else {
-					value = 0;
+		for (int c = 0; c < ncand; c++) {
+			int i = cand[c];
+			temp = meval[c];
+			if (temp >= 3000) return 3000;
+
+			total = cumulative + temp;
+
+			if (depth > 0) {
+				update_adjacent(i, color);
+				value = minimax(depth-1, 0, alpha, beta, (color + 1) % 2, total);
+				remove_adjacent(i);
+			} else {
+				value = 0;
+			}
+			temp += value;
+			total += value;
+
+			if (alpha < total) alpha = total;
+			if (bestValue < temp) {
+				bestValue = temp;
+				bestMove = i;
+			}
+			if (alpha >= beta) {
+				cutoff = 1;
+				ctx->cutoffs++;
+				if (ctx->killer[depth][0] != i) {
+					ctx->killer[depth][1] = ctx->killer[depth][0];
+					ctx->killer[depth][0] = i;
 				}
-				temp += value;
-				total += value;
-			
-				if (alpha < total) alpha = total;
-				if (bestValue < temp) bestValue = temp;		
-				if (alpha >= beta) break;
+				ctx->history[i] += depth * depth;
+				break;
 			}
 		}
 	} else {
 		bestValue = 10000;
-		for (int i = 0; i < BOARD_SIZE*BOARD_SIZE; i++) {
-			if (board[i] == 3) {
-				temp = -evaluate(i, color);
-				if (temp <= -3000) return -3000;
+		for (int c = 0; c < ncand; c++) {
+			int i = cand[c];
+			temp = -meval[c];
+			if (temp <= -3000) return -3000;
 
-				total = cumulative + temp;
+			total = cumulative + temp;
 
-				if (depth > 0) {
-					update_adjacent(i, color);
-					value = minimax(depth-1, 1, alpha, beta, (color + 1) % 2, total);	
-					remove_adjacent(i);
-				} else {
-					value = 0;
+			if (depth > 0) {
+				update_adjacent(i, color);
+				value = minimax(depth-1, 1, alpha, beta, (color + 1) % 2, total);
+				remove_adjacent(i);
+			} else {
+				value = 0;
+			}
+			temp += value;
+			total += value;
+
+			if (beta > total) beta = total;
+			if (bestValue > temp) {
+				bestValue = temp;
+				bestMove = i;
+			}
+			if (alpha >= beta) {
+				cutoff = 1;
+				ctx->cutoffs++;
+				if (ctx->killer[depth][0] != i) {
+					ctx->killer[depth][1] = ctx->killer[depth][0];
+					ctx->killer[depth][0] = i;
 				}
-				temp += value;
-				total += value;
-				
-				if (beta > total) beta = total;
-				if (bestValue > temp) bestValue = temp;
-				if (alpha >= beta) break;		
+				ctx->history[i] += depth * depth;
+				break;
+			}
+		}
+	}
+
+	/* store, replacing shallower entries */
+	if (entry != NULL && bestMove >= 0
+			&& (entry->key == 0 || entry->key == key || depth >= entry->depth)) {
+		entry->key = key;
+		entry->score = bestValue;
+		entry->best = (short)bestMove;
+		entry->depth = (char)depth;
+		if (turn == 1) {
+			if (cutoff) {
+				entry->flag = TT_LOWER;
+			} else if (cumulative + bestValue <= alpha_in) {
+				entry->flag = TT_UPPER;
+			} else {
+				entry->flag = TT_EXACT;
+			}
+		} else {
+			if (cutoff) {
+				entry->flag = TT_UPPER;
+			} else if (cumulative + bestValue >= beta_in) {
+				entry->flag = TT_LOWER;
+			} else {
+				entry->flag = TT_EXACT;
 			}
 		}
 	}
 	return bestValue;
 }
 
+/* shared state of the one node whose children are searched in parallel:
+ * the reply node directly under the worker's root move */
+typedef struct {
+	int cand[MAX_MOVES];
+	int meval[MAX_MOVES];
+	int ncand;
+	int next;           /* next child a thread may claim */
+	int depth, color, cumulative;
+	int alpha, beta, bestValue;
+	int cutoff;
+	long nodes, cutoffs;
+	pthread_mutex_t lock;
+} ParallelNode;
+
+typedef struct {
+	ParallelNode *node;
+	SearchContext *sc;
+	uint64_t *block;
+} StealArg;
+
+/**
+ * Copies the main context into a private per-thread context, with its own
+ * copy of the bitboard block.
+ *
+ * @param dst the context to fill
+ * @param block storage for 3 * board_words bitboard words
+*/
+void copy_context(SearchContext *dst, uint64_t *block) {
+	*dst = main_search;
+	memcpy(block, bitboards, 3 * board_words * sizeof(uint64_t));
+	dst->stones[BLACK] = block;
+	dst->stones[WHITE] = block + board_words;
+	dst->candidates = block + 2 * board_words;
+	dst->undo_top = 0;
+	dst->nodes = 0;
+	dst->cutoffs = 0;
+}
+
+/**
+ * Claims children of the given node one at a time and searches each with
+ * the calling thread's context, folding the results back under the node
+ * lock.  Run by the main thread and every pool thread alike.
+ *
+ * @param pn the node being expanded
+*/
+void steal_loop(ParallelNode *pn) {
+	while (1) {
+		pthread_mutex_lock(&pn->lock);
+		int c = pn->next;
+		int alpha = pn->alpha;
+		int beta = pn->beta;
+		int stop = pn->cutoff || c >= pn->ncand;
+		if (!stop) pn->next++;
+		pthread_mutex_unlock(&pn->lock);
+		if (stop) break;
+
+		int i = pn->cand[c];
+		int temp = -pn->meval[c];
+		int value = 0;
+
+		if (temp <= -3000) {
+			pthread_mutex_lock(&pn->lock);
+			pn->bestValue = -3000;
+			pn->cutoff = 1;
+			pthread_mutex_unlock(&pn->lock);
+			break;
+		}
+		int total = pn->cumulative + temp;
+		if (pn->depth > 0) {
+			update_adjacent(i, pn->color);
+			value = minimax(pn->depth - 1, 1, alpha, beta,
+					(pn->color + 1) % 2, total);
+			remove_adjacent(i);
+		}
+		temp += value;
+		total += value;
+
+		pthread_mutex_lock(&pn->lock);
+		if (pn->beta > total) pn->beta = total;
+		if (pn->bestValue > temp) pn->bestValue = temp;
+		if (pn->alpha >= pn->beta) pn->cutoff = 1;
+		pthread_mutex_unlock(&pn->lock);
+	}
+}
+
+void *steal_children(void *vp) {
+	StealArg *arg = vp;
+
+	ctx = arg->sc;
+	steal_loop(arg->node);
+	pthread_mutex_lock(&arg->node->lock);
+	arg->node->nodes += ctx->nodes;
+	arg->node->cutoffs += ctx->cutoffs;
+	pthread_mutex_unlock(&arg->node->lock);
+	return NULL;
+}
+
+/**
+ * Searches the reply node under the worker's root move, splitting its
+ * children across the rank's threads.  Young Brothers Wait style: the first
+ * (best-ordered) child is searched serially to establish a bound, then the
+ * main thread and the pool threads claim the remaining siblings from a
+ * shared index, each on a private copy of the position.
+ *
+ * @param depth search depth at this node
+ * @param alpha
+ * @param beta
+ * @param color colour to move at this node
+ * @param cumulative cumulative evaluation, as in minimax
+*/
+int search_root(int depth, int alpha, int beta, int color, int cumulative) {
+	ParallelNode pn;
+	int nspawn = worker_threads - 1;
+
+	if (nspawn < 1 || depth <= 2 || ctx->cand_count < 4) {
+		return minimax(depth, 0, alpha, beta, color, cumulative);
+	}
+
+	ctx->nodes++;
+	pn.ncand = ctx->cand_count;
+	memcpy(pn.cand, ctx->cand_list, ctx->cand_count * sizeof(int));
+	for (int c = 0; c < pn.ncand; c++) {
+		pn.meval[c] = evaluate(pn.cand[c], color);
+	}
+	for (int c = 1; c < pn.ncand; c++) {
+		int e = pn.meval[c], m = pn.cand[c];
+		int j = c - 1;
+		while (j >= 0 && pn.meval[j] < e) {
+			pn.meval[j+1] = pn.meval[j];
+			pn.cand[j+1] = pn.cand[j];
+			j--;
+		}
+		pn.meval[j+1] = e;
+		pn.cand[j+1] = m;
+	}
+
+	pn.depth = depth;
+	pn.color = color;
+	pn.cumulative = cumulative;
+	pn.alpha = alpha;
+	pn.beta = beta;
+	pn.bestValue = 10000;
+	pn.cutoff = 0;
+	pn.nodes = 0;
+	pn.cutoffs = 0;
+	pthread_mutex_init(&pn.lock, NULL);
+
+	/* first child serially, to give the siblings a real bound */
+	{
+		int i = pn.cand[0];
+		int temp = -pn.meval[0];
+		int value = 0;
+
+		if (temp <= -3000) return -3000;
+		int total = cumulative + temp;
+		update_adjacent(i, color);
+		value = minimax(depth - 1, 1, pn.alpha, pn.beta, (color + 1) % 2,
+				total);
+		remove_adjacent(i);
+		temp += value;
+		total += value;
+		if (pn.beta > total) pn.beta = total;
+		pn.bestValue = temp;
+		if (pn.alpha >= pn.beta) pn.cutoff = 1;
+	}
+	pn.next = 1;
+
+	if (!pn.cutoff) {
+		pthread_t *tids = malloc(nspawn * sizeof(pthread_t));
+		StealArg *args = malloc(nspawn * sizeof(StealArg));
+
+		for (int t = 0; t < nspawn; t++) {
+			args[t].node = &pn;
+			args[t].sc = malloc(sizeof(SearchContext));
+			args[t].block = malloc(3 * board_words * sizeof(uint64_t));
+			copy_context(args[t].sc, args[t].block);
+			pthread_create(&tids[t], NULL, steal_children, &args[t]);
+		}
+		steal_loop(&pn);
+		for (int t = 0; t < nspawn; t++) {
+			pthread_join(tids[t], NULL);
+			free(args[t].sc);
+			free(args[t].block);
+		}
+		free(tids);
+		free(args);
+	}
+	pthread_mutex_destroy(&pn.lock);
+	ctx->nodes += pn.nodes;
+	ctx->cutoffs += pn.cutoffs;
+	return pn.bestValue;
+}
+
 /**
  * Evaluation function for evaluating a move.
  * 
@@ -305,30 +1082,36 @@ int minimax(int depth, int turn, int alpha, int beta, int color, int cumulative)
 int evaluate(int pos, int my_colour) {
     int score = 0;
     int continuous;
-    
+
 	int k = BOARD_SIZE;
+	int row = row_of[pos];
+	int col = col_of[pos];
 	int open_ends = 0;
 
+	if (ctx->eval_valid[my_colour][pos]) return ctx->eval_cache[my_colour][pos];
+
     // Directions: horizontal, vertical, two diagonals
     int directions[4] = {1, k, k+1, k-1};
 
     for (int d = 0; d < 4; d++) {
-        continuous = 1;  
+        continuous = 1;
 		open_ends = 0;
-		
+
         for (int i = 1; i < 5; i++) {
-            if (pos + i * directions[d] >= k * k || pos % k + i >= k || pos / k + i >= k) break;  
-            if (board[pos + i * directions[d]] != my_colour) {
-				if (board[pos + i * directions[d]] == 3 || board[pos + i * directions[d]] == EMPTY) open_ends++;
+            if (pos + i * directions[d] >= k * k || col + i >= k || row + i >= k) break;
+            if (!(ctx->stones[my_colour][BB_WORD(pos + i * directions[d])]
+					& BB_BIT(pos + i * directions[d]))) {
+				if (!has_stone(pos + i * directions[d])) open_ends++;
 				break;
-			} 
+			}
             continuous++;
         }
-		
+
         for (int i = 1; i < 5; i++) {
-            if (pos - i * directions[d] < 0 || pos % k - i < 0 || pos / k - i < 0) break;  
-            if (board[pos - i * directions[d]] != my_colour) {
-				if (board[pos - i * directions[d]] == 3 || board[pos - i * directions[d]] == EMPTY) open_ends++;
+            if (pos - i * directions[d] < 0 || col - i < 0 || row - i < 0) break;
+            if (!(ctx->stones[my_colour][BB_WORD(pos - i * directions[d])]
+					& BB_BIT(pos - i * directions[d]))) {
+				if (!has_stone(pos - i * directions[d])) open_ends++;
 				break;
 			}
             continuous++;
@@ -353,19 +1136,106 @@ int evaluate(int pos, int my_colour) {
             if (open_ends == 2) {
                 score += 10;  
             } else if (open_ends == 1) {
-                score += 5;  
+                score += 5;
             }
         }
     }
+	ctx->eval_cache[my_colour][pos] = score;
+	ctx->eval_valid[my_colour][pos] = 1;
     return score;
 }
 
 
+/**
+ * Shifts a multiword bitboard towards lower cell indices: bit c of dst is
+ * bit c + n of src, with zeroes shifted in from beyond the board.
+ *
+ * @param dst the shifted bitboard, board_words words
+ * @param src the bitboard to shift
+ * @param n the shift distance in cells
+*/
+void bb_shift_down(uint64_t *dst, const uint64_t *src, int n) {
+	int q = n >> 6, r = n & 63;
+
+	for (int w = 0; w < board_words; w++) {
+		uint64_t lo = (w + q < board_words) ? src[w + q] : 0;
+		uint64_t hi = (w + q + 1 < board_words) ? src[w + q + 1] : 0;
+		dst[w] = (r == 0) ? lo : (lo >> r) | (hi << (64 - r));
+	}
+}
+
+/**
+ * Shifts a multiword bitboard towards higher cell indices: bit c of dst is
+ * bit c - n of src, with zeroes shifted in from below cell zero.
+ *
+ * @param dst the shifted bitboard, board_words words
+ * @param src the bitboard to shift
+ * @param n the shift distance in cells
+*/
+void bb_shift_up(uint64_t *dst, const uint64_t *src, int n) {
+	int q = n >> 6, r = n & 63;
+
+	for (int w = board_words - 1; w >= 0; w--) {
+		uint64_t hi = (w - q >= 0) ? src[w - q] : 0;
+		uint64_t lo = (w - q - 1 >= 0) ? src[w - q - 1] : 0;
+		dst[w] = (r == 0) ? hi : (hi << r) | (lo >> (64 - r));
+	}
+}
+
+/**
+ * Finds every cell where the given colour completes five in a row, over the
+ * whole board in one word-parallel pass.  For each direction, prefix-ANDs of
+ * the shifted stone bitboard mark the cells with j consecutive own stones
+ * ahead of (and behind) them, and any split of four such stones around an
+ * empty cell is a win.  The boundary behaviour matches evaluate exactly,
+ * including its column/row break rules, so a set bit means evaluate would
+ * score that cell at 3000 or more.  The bitboards already pack 64 cells per
+ * machine word, so plain shifts and ANDs do the batch work the per-candidate
+ * walks did, with no instruction-set dependency.
+ *
+ * @param color the colour whose winning cells to find
+ * @param out bitboard receiving the winning cells, board_words words
+*/
+void threat_scan(int color, uint64_t *out) {
+	uint64_t fwd[5][MAX_WORDS], bwd[5][MAX_WORDS], t[MAX_WORDS];
+	int directions[4] = {1, BOARD_SIZE, BOARD_SIZE + 1, BOARD_SIZE - 1};
+
+	memset(out, 0, board_words * sizeof(uint64_t));
+	for (int d = 0; d < 4; d++) {
+		for (int w = 0; w < board_words; w++) {
+			fwd[0][w] = ~0ULL;
+			bwd[0][w] = ~0ULL;
+		}
+		for (int j = 1; j <= 4; j++) {
+			bb_shift_down(t, ctx->stones[color], j * directions[d]);
+			for (int w = 0; w < board_words; w++) {
+				fwd[j][w] = fwd[j-1][w] & t[w] & step_fwd_mask[j][w];
+			}
+			bb_shift_up(t, ctx->stones[color], j * directions[d]);
+			for (int w = 0; w < board_words; w++) {
+				bwd[j][w] = bwd[j-1][w] & t[w] & step_bwd_mask[j][w];
+			}
+		}
+		for (int w = 0; w < board_words; w++) {
+			out[w] |= fwd[4][w]
+					| (fwd[3][w] & bwd[1][w])
+					| (fwd[2][w] & bwd[2][w])
+					| (fwd[1][w] & bwd[3][w])
+					| bwd[4][w];
+		}
+	}
+
+	/* only empty cells can be played */
+	for (int w = 0; w < board_words; w++) {
+		out[w] &= ~(ctx->stones[BLACK][w] | ctx->stones[WHITE][w]);
+	}
+}
+
 /**
  * Updating the adjacent positions on the board when a move is played
- * 
+ *
  * @param new_move
- * @param color 
+ * @param color
  *
  * */
 void update_adjacent(int new_move, int color) {
@@ -379,8 +1249,15 @@ void update_adjacent(int new_move, int color) {
         new_move - BOARD_SIZE,     // Up
         new_move + BOARD_SIZE      // Down
     };
+    UndoFrame *u = &ctx->undo_stack[ctx->undo_top++];
 
-    board[new_move] = color; 
+    u->move = new_move;
+    u->nadded = 0;
+    u->was_candidate = ctx->cand_index[new_move] >= 0;
+    if (u->was_candidate) del_candidate(new_move);
+    ctx->stones[color][BB_WORD(new_move)] |= BB_BIT(new_move);
+    ctx->board_hash ^= zobrist[color][new_move];
+    dirty_lines(new_move);
 
     for (int i = 0; i < 8; i++) {
         int pos = potential_adjacent[i];
@@ -388,9 +1265,11 @@ void update_adjacent(int new_move, int color) {
         if (pos >= 0 && pos < BOARD_SIZE * BOARD_SIZE) {
             if (new_move % BOARD_SIZE == 0 && i <= 2) continue;
             if (new_move % BOARD_SIZE == BOARD_SIZE - 1 && i >= 3 && i <= 5) continue;
-			if (board[pos] == BLACK) continue;
-			if (board[pos] == WHITE) continue;
-            board[pos] = 3; // Mark as adjacent
+			if (has_stone(pos)) continue;
+			if (ctx->cand_index[pos] < 0) {
+				add_candidate(pos); // Mark as adjacent
+				u->added[u->nadded++] = pos;
+			}
         }
     }
 }
@@ -402,38 +1281,22 @@ void update_adjacent(int new_move, int color) {
  * @param new_move - the position to set to empty
 */
 void remove_adjacent(int new_move) {
-    int potential_adjacent[] = {
-        new_move - BOARD_SIZE - 1, // Top-left
-        new_move - 1,              // Left
-        new_move + BOARD_SIZE - 1, // Bottom-left
-        new_move + BOARD_SIZE + 1, // Bottom-right
-		new_move - BOARD_SIZE + 1, // Top-right
-        new_move + 1,              // Right
-        new_move - BOARD_SIZE,     // Up
-        new_move + BOARD_SIZE      // Down
-    };
+    UndoFrame *u = &ctx->undo_stack[--ctx->undo_top];
 
-    board[new_move] = 3;
-
-    for (int i = 0; i < 8; i++) {
-        int pos = potential_adjacent[i];
+    if (ctx->stones[BLACK][BB_WORD(new_move)] & BB_BIT(new_move)) {
+        ctx->board_hash ^= zobrist[BLACK][new_move];
+    } else if (ctx->stones[WHITE][BB_WORD(new_move)] & BB_BIT(new_move)) {
+        ctx->board_hash ^= zobrist[WHITE][new_move];
+    }
+    ctx->stones[BLACK][BB_WORD(new_move)] &= ~BB_BIT(new_move);
+    ctx->stones[WHITE][BB_WORD(new_move)] &= ~BB_BIT(new_move);
+    dirty_lines(new_move);
 
-        
-        if (pos >= 0 && pos < BOARD_SIZE * BOARD_SIZE) {
-            // Avoid row wrapping from left to right
-            if (new_move % BOARD_SIZE == 0 && i <= 2) continue;
-            // Avoid row wrapping from right to left
-            if (new_move % BOARD_SIZE == BOARD_SIZE - 1 && i >= 3 && i <= 5) continue;
-			if (board[pos] == BLACK) continue;
-			if (board[pos] == WHITE) continue;
-			int d;
-			for (d = 0; d < 8; d++) {
-				if (board[potential_adjacent[d] - new_move + pos] == WHITE) break;
-				if (board[potential_adjacent[d] + pos - new_move] == BLACK) break;
-			}
-			if (d == 8) board[pos] = EMPTY;
-        }
+    /* reverse exactly what the matching update_adjacent did */
+    for (int i = 0; i < u->nadded; i++) {
+        del_candidate(u->added[i]);
     }
+    if (u->was_candidate) add_candidate(new_move);
 }
 
 
@@ -488,7 +1351,207 @@ int random_strategy(int my_colour, FILE *fp) {
  * @param my_colour colour of the player
 */
 void make_move(int move, int colour) {
-	board[move] = colour;
+	if (ctx->cand_index[move] >= 0) del_candidate(move);
+	ctx->stones[colour][BB_WORD(move)] |= BB_BIT(move);
+	dirty_lines(move);
+}
+
+/**
+ * Adds a position to the candidate set (list, index map and bitboard).
+ *
+ * @param pos the cell to add
+*/
+void add_candidate(int pos) {
+	ctx->cand_index[pos] = ctx->cand_count;
+	ctx->cand_list[ctx->cand_count++] = pos;
+	ctx->candidates[BB_WORD(pos)] |= BB_BIT(pos);
+}
+
+/**
+ * Removes a position from the candidate set by swapping the last list entry
+ * into its slot.
+ *
+ * @param pos the cell to remove
+*/
+void del_candidate(int pos) {
+	int slot = ctx->cand_index[pos];
+	int last = ctx->cand_list[--ctx->cand_count];
+
+	ctx->cand_list[slot] = last;
+	ctx->cand_index[last] = slot;
+	ctx->cand_index[pos] = -1;
+	ctx->candidates[BB_WORD(pos)] &= ~BB_BIT(pos);
+}
+
+/**
+ * Invalidates the cached evaluations on the four lines through the given
+ * cell, out to evaluation range.  Called whenever a stone is placed on or
+ * removed from the cell.
+ *
+ * @param move the cell whose lines changed
+*/
+void dirty_lines(int move) {
+	int dirs[4] = {1, BOARD_SIZE, BOARD_SIZE + 1, BOARD_SIZE - 1};
+
+	ctx->eval_valid[BLACK][move] = 0;
+	ctx->eval_valid[WHITE][move] = 0;
+	for (int d = 0; d < 4; d++) {
+		for (int s = -1; s <= 1; s += 2) {
+			for (int i = 1; i < 5; i++) {
+				int p = move + s * i * dirs[d];
+				int cd = col_of[move] - (p >= 0 && p < BOARD_SIZE * BOARD_SIZE
+						? col_of[p] : 100);
+				if (p < 0 || p >= BOARD_SIZE * BOARD_SIZE
+						|| cd < -4 || cd > 4) {
+					break;
+				}
+				ctx->eval_valid[BLACK][p] = 0;
+				ctx->eval_valid[WHITE][p] = 0;
+			}
+		}
+	}
+}
+
+/**
+ * Returns the state of the given board cell: BLACK, WHITE, CANDIDATE or EMPTY.
+ *
+ * @param pos the cell to inspect
+*/
+int cell_at(int pos) {
+	if (ctx->stones[BLACK][BB_WORD(pos)] & BB_BIT(pos)) return BLACK;
+	if (ctx->stones[WHITE][BB_WORD(pos)] & BB_BIT(pos)) return WHITE;
+	if (ctx->candidates[BB_WORD(pos)] & BB_BIT(pos)) return CANDIDATE;
+	return EMPTY;
+}
+
+/**
+ * Returns 1 if either colour has a stone on the given cell.
+ *
+ * @param pos the cell to inspect
+*/
+int has_stone(int pos) {
+	return ((ctx->stones[BLACK][BB_WORD(pos)] | ctx->stones[WHITE][BB_WORD(pos)])
+			& BB_BIT(pos)) != 0;
+}
+
+/**
+ * Counts the stones the given colour has on the board.
+ *
+ * @param color the colour to count for
+*/
+int stone_count(int color) {
+	int n = 0;
+
+	for (int w = 0; w < board_words; w++) {
+		n += __builtin_popcountll(ctx->stones[color][w]);
+	}
+	return n;
+}
+
+/**
+ * Fills the Zobrist tables with fixed pseudo-random words (splitmix64), so
+ * every rank generates the same keys.
+*/
+void init_zobrist(void) {
+	uint64_t s = 0x9E3779B97F4A7C15ULL;
+	uint64_t *words = &zobrist[0][0];
+
+	for (int i = 0; i < 2 * MAX_MOVES + 1; i++) {
+		uint64_t z = (s += 0x9E3779B97F4A7C15ULL);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		z ^= z >> 31;
+		if (i < 2 * MAX_MOVES) {
+			words[i] = z;
+		} else {
+			zobrist_side = z;
+		}
+	}
+}
+
+/**
+ * Maps the opening book from its backing file, creating it on first use.
+ * The file is sized for the full table up front and mapped MAP_SHARED, so
+ * stores land in the file without any explicit save step.  A missing or
+ * unmappable file just disables the book.
+*/
+void book_open(void) {
+	char fname[32];
+	long bytes = BOOK_SIZE * sizeof(BookEntry);
+
+	sprintf(fname, "book_%d.dat", BOARD_SIZE);
+	book_fd = open(fname, O_RDWR | O_CREAT, 0644);
+	if (book_fd < 0) return;
+	if (ftruncate(book_fd, bytes) != 0) {
+		close(book_fd);
+		book_fd = -1;
+		return;
+	}
+	book = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, book_fd, 0);
+	if (book == MAP_FAILED) {
+		book = NULL;
+		close(book_fd);
+		book_fd = -1;
+	}
+}
+
+/**
+ * Flushes the opening book to its backing file and unmaps it.
+*/
+void book_close(void) {
+	if (book != NULL) {
+		msync(book, BOOK_SIZE * sizeof(BookEntry), MS_SYNC);
+		munmap(book, BOOK_SIZE * sizeof(BookEntry));
+		book = NULL;
+	}
+	if (book_fd >= 0) {
+		close(book_fd);
+		book_fd = -1;
+	}
+}
+
+/**
+ * Looks the current position up in the opening book.  A hit must match the
+ * full key, come from a deep enough search to trust, and name a cell that is
+ * still empty (a colliding entry from another position would not).
+ *
+ * @param my_colour the colour this player is playing as
+ * @return the book move, or -1 on a miss
+*/
+int book_probe(int my_colour) {
+	uint64_t key;
+	BookEntry *entry;
+
+	if (book == NULL) return -1;
+	key = ctx->board_hash ^ (my_colour == WHITE ? zobrist_side : 0);
+	entry = &book[key & (BOOK_SIZE - 1)];
+	if (entry->key != key || entry->depth < BOOK_MIN_DEPTH) return -1;
+	if (entry->move < 0 || entry->move >= BOARD_SIZE * BOARD_SIZE) return -1;
+	if (has_stone(entry->move)) return -1;
+	return entry->move;
+}
+
+/**
+ * Records a searched move in the opening book.  Only shallow positions are
+ * worth keeping -- openings repeat across matches, middlegames do not -- and
+ * an occupied slot is only replaced by a result from a deeper search.
+ *
+ * @param my_colour the colour this player is playing as
+ * @param move the move the search chose
+ * @param depth the deepest iteration that completed
+*/
+void book_store(int my_colour, int move, int depth) {
+	uint64_t key;
+	BookEntry *entry;
+
+	if (book == NULL || ctx->undo_top > BOOK_MAX_PLY) return;
+	key = ctx->board_hash ^ (my_colour == WHITE ? zobrist_side : 0);
+	entry = &book[key & (BOOK_SIZE - 1)];
+	if (depth >= entry->depth) {
+		entry->key = key;
+		entry->move = move;
+		entry->depth = depth;
+	}
 }
 
 /**
@@ -504,7 +1567,7 @@ void legal_moves(int *moves, int *number_of_moves) {
 	for (i = 0; i < BOARD_SIZE; i++) {
 		for (j = 0; j < BOARD_SIZE; j++) {
 
-			if (board[i * BOARD_SIZE + j] == EMPTY) {
+			if (cell_at(i * BOARD_SIZE + j) == EMPTY) {
 				moves[k++] = i * BOARD_SIZE + j;
 				(*number_of_moves)++;
 			}
@@ -519,8 +1582,34 @@ void legal_moves(int *moves, int *number_of_moves) {
  * Initialises the board for the game.
  */
 void initialise_board(void) {
-	board = malloc(sizeof(int) * BOARD_SIZE * BOARD_SIZE);
-	memset(board, EMPTY, sizeof(int) * BOARD_SIZE * BOARD_SIZE);
+	board_words = (BOARD_SIZE * BOARD_SIZE + 63) / 64;
+	bitboards = calloc(3 * board_words, sizeof(uint64_t));
+	ctx = &main_search;
+	ctx->stones[BLACK] = bitboards;
+	ctx->stones[WHITE] = bitboards + board_words;
+	ctx->candidates = bitboards + 2 * board_words;
+	ctx->board_hash = 0;
+	ctx->cand_count = 0;
+	ctx->undo_top = 0;
+	memset(ctx->cand_index, -1, sizeof(ctx->cand_index));
+	memset(ctx->eval_valid, 0, sizeof(ctx->eval_valid));
+	for (int i = 0; i < BOARD_SIZE * BOARD_SIZE; i++) {
+		row_of[i] = i / BOARD_SIZE;
+		col_of[i] = i % BOARD_SIZE;
+	}
+
+	memset(step_fwd_mask, 0, sizeof(step_fwd_mask));
+	memset(step_bwd_mask, 0, sizeof(step_bwd_mask));
+	for (int j = 1; j <= 4; j++) {
+		for (int i = 0; i < BOARD_SIZE * BOARD_SIZE; i++) {
+			if (col_of[i] + j < BOARD_SIZE && row_of[i] + j < BOARD_SIZE) {
+				step_fwd_mask[j][BB_WORD(i)] |= BB_BIT(i);
+			}
+			if (col_of[i] - j >= 0 && row_of[i] - j >= 0) {
+				step_bwd_mask[j][BB_WORD(i)] |= BB_BIT(i);
+			}
+		}
+	}
 }
 
 /**
@@ -550,11 +1639,11 @@ void print_board(FILE *fp) {
 		fprintf(fp, "%2d |", i + 1);
 		for (int j = 0; j < BOARD_SIZE; j++) {
 			char piece = '.';
-			if (board[i * BOARD_SIZE + j] == BLACK) {
+			if (ctx->stones[BLACK][BB_WORD(i * BOARD_SIZE + j)] & BB_BIT(i * BOARD_SIZE + j)) {
 				piece = 'B';
-			} else if (board[i * BOARD_SIZE + j] == WHITE) {
+			} else if (ctx->stones[WHITE][BB_WORD(i * BOARD_SIZE + j)] & BB_BIT(i * BOARD_SIZE + j)) {
 				piece = 'W';
-			} 
+			}
 			fprintf(fp, "%c  ", piece);
 		}
 		fprintf(fp, "|");
@@ -574,7 +1663,7 @@ void print_board(FILE *fp) {
  * Frees the memory allocated for the board.
  */
 void free_board(void) {
-	free(board);
+	free(bitboards);
 }
 
 /**